@@ -38,6 +38,9 @@ extern "C" {
 #define TIC80_SAMPLERATE 44100
 #define TIC80_FRAMERATE 60
 
+// default us of the spare frame time given to tic80_idle
+#define TIC80_IDLE_BUDGET 1000
+
 typedef enum {
     TIC80_PIXEL_COLOR_ARGB8888 = (1 << 8) | 32,
     TIC80_PIXEL_COLOR_ABGR8888 = (2 << 8) | 32,
@@ -45,6 +48,11 @@ typedef enum {
     TIC80_PIXEL_COLOR_BGRA8888 = (4 << 8) | 32
 } tic80_pixel_color_format;
 
+typedef enum {
+    TIC80_SAMPLE_FORMAT_S16,
+    TIC80_SAMPLE_FORMAT_F32,
+} tic80_sample_format;
+
 typedef struct 
 {
 	struct
@@ -56,8 +64,16 @@ typedef struct
 
 	struct
 	{
-		s16* samples;
+		// interleaved stereo, 16 bit unless another format was passed to tic80_create_format
+		union
+		{
+			s16* samples;
+			float* fsamples;
+		};
+
+		// changes from tick to tick when the rate is not a multiple of the frame rate
 		s32 count;
+		tic80_sample_format format;
 	} sound;
 
 	u32* screen;
@@ -135,8 +151,12 @@ typedef struct
 } tic80_input;
 
 TIC80_API tic80* tic80_create(s32 samplerate);
+// same as tic80_create, the sound is delivered in the given format
+TIC80_API tic80* tic80_create_format(s32 samplerate, tic80_sample_format format);
 TIC80_API void tic80_load(tic80* tic, void* cart, s32 size);
 TIC80_API void tic80_tick(tic80* tic, const tic80_input* input);
+// runs the script garbage collector for up to budget us, call between a tick and the frame wait
+TIC80_API void tic80_idle(tic80* tic, s32 budget);
 TIC80_API void tic80_delete(tic80* tic);
 
 #ifdef __cplusplus
@@ -50,6 +50,7 @@ typedef struct tic_mem tic_mem;
 typedef void(*tic_tick)(tic_mem* memory);
 typedef void(*tic_scanline)(tic_mem* memory, s32 row, void* data);
 typedef void(*tic_overline)(tic_mem* memory, void* data);
+typedef void(*tic_idle)(tic_mem* memory, u64 deadline);
 
 typedef struct
 {
@@ -67,11 +68,21 @@ typedef struct
         tic_tick tick;
         tic_scanline scanline;
         tic_overline overline;
+
+        // housekeeping in the spare frame time until the tick data counter reaches deadline
+        tic_idle idle;
     };
 
     const tic_outline_item* (*getOutline)(const char* code, s32* size);
     void (*eval)(tic_mem* tic, const char* code);
 
+    // optional, precompiles the code for the cart binary chunk
+    bool (*compile)(const char* code, tic_binary* binary);
+
+    // names the compiler in the studio binary cache key, NULL when compiling
+    // the source on every run is cheap enough
+    const char* compiler;
+
     const char* blockCommentStart;
     const char* blockCommentEnd;
     const char* blockCommentStart2;
@@ -94,6 +105,36 @@ typedef struct
     s32 x, y, w, h;
 } tic_rect;
 
+// music position in ticks of the track played once from the start, tick is -1 when stopped
+typedef struct
+{
+    s32 tick;
+    s32 duration;
+} tic_music_pos;
+
+// packed sprite record used by sprs(), little-endian:
+// index:u16 x:s16 y:s16 colorkey:u8 scale:u8 flip:u8 rotate:u8 w:u8 h:u8
+// colorkey 255 means no transparent color
+#define TIC_SPRITE_RECORD_SIZE 12
+#define TIC_SPRITE_RECORD_NOKEY 255
+
+// mesh() RAM layout, little-endian:
+// vertex x:s16 y:s16 z:s16, uv u:s16 v:s16, triangle i0:u16 i1:u16 i2:u16
+#define TIC_MESH_VERTEX_SIZE 6
+#define TIC_MESH_UV_SIZE 4
+#define TIC_MESH_TRIANGLE_SIZE 6
+
+// mesh() flags
+#define TIC_MESH_CULL 1         // skip triangles wound counter-clockwise on screen
+#define TIC_MESH_DEPTH 2        // test and write the depth buffer, smaller z is closer
+#define TIC_MESH_CLEAR_DEPTH 4  // clear the depth buffer before drawing
+
+// peekbuf()/pokebuf() copy whole byte ranges between RAM and a script string or array,
+// false when the range is out of RAM; memcpy4()/memset4() take nibble addresses and counts
+
+// ram() returns size bytes of RAM from the address, NULL when out of range,
+// scripts wrap it in a view that reads and writes the RAM in place
+
 #define TIC_FN "TIC"
 #define SCN_FN "SCN"
 #define OVR_FN "OVR"
@@ -111,6 +152,7 @@ typedef struct
     macro(rect,         5,  void,       tic_mem*, s32 x, s32 y, s32 width, s32 height, u8 color) \
     macro(rectb,        5,  void,       tic_mem*, s32 x, s32 y, s32 width, s32 height, u8 color) \
     macro(spr,          9,  void,       tic_mem*, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate) \
+    macro(sprs,         2,  void,       tic_mem*, const u8* records, s32 size, s32 count) \
     macro(btn,          1,  u32,        tic_mem*, s32 id) \
     macro(btnp,         3,  u32,        tic_mem*, s32 id, s32 hold, s32 period) \
     macro(sfx,          6,  void,       tic_mem*, s32 index, s32 note, s32 octave, s32 duration, s32 channel, s32 left, s32 right, s32 speed) \
@@ -123,6 +165,11 @@ typedef struct
     macro(poke4,        2,  void,       tic_mem*, s32 address, u8 value) \
     macro(memcpy,       3,  void,       tic_mem*, s32 dst, s32 src, s32 size) \
     macro(memset,       3,  void,       tic_mem*, s32 dst, u8 val, s32 size) \
+    macro(peekbuf,      2,  bool,       tic_mem*, s32 address, u8* data, s32 size) \
+    macro(pokebuf,      2,  bool,       tic_mem*, s32 address, const u8* data, s32 size) \
+    macro(memcpy4,      3,  void,       tic_mem*, s32 dst, s32 src, s32 size) \
+    macro(memset4,      3,  void,       tic_mem*, s32 dst, u8 val, s32 size) \
+    macro(ram,          2,  u8*,        tic_mem*, s32 address, s32 size) \
     macro(trace,        2,  void,       tic_mem*, const char* text, u8 color) \
     macro(pmem,         2,  u32,        tic_mem*, s32 index, u32 value, bool get) \
     macro(time,         0,  double,     tic_mem*) \
@@ -132,10 +179,14 @@ typedef struct
     macro(mouse,        0,  tic_point,  tic_mem*) \
     macro(circ,         4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
     macro(circb,        4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
+    macro(elli,         5,  void,       tic_mem*, s32 x, s32 y, s32 a, s32 b, u8 color) \
+    macro(ellib,        5,  void,       tic_mem*, s32 x, s32 y, s32 a, s32 b, u8 color) \
     macro(tri,          7,  void,       tic_mem*, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color) \
-    macro(textri,       14, void,       tic_mem*, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count) \
+    macro(textri,       17, void,       tic_mem*, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count, float z1, float z2, float z3, bool perspective) \
+    macro(mesh,         8,  void,       tic_mem*, s32 vertices, s32 indices, s32 count, u8 color, u8 flags, s32 uvs, bool use_map, u8* colors, s32 colorCount) \
     macro(clip,         4,  void,       tic_mem*, s32 x, s32 y, s32 width, s32 height) \
     macro(music,        4,  void,       tic_mem*, s32 track, s32 frame, s32 row, bool loop, bool sustain) \
+    macro(mpos,         0,  tic_music_pos, tic_mem*) \
     macro(sync,         3,  void,       tic_mem*, u32 mask, s32 bank, bool toCart) \
     macro(reset,        0,  void,       tic_mem*) \
     macro(key,          1,  bool,       tic_mem*, tic_key key) \
@@ -171,7 +222,7 @@ struct tic_mem
     struct
     {
         s16* buffer;
-        s32 size;
+        s32 size; // bytes of the last frame, varies when the rate is not a multiple of the frame rate
     } samples;
 
 #if defined(_3DS)
@@ -182,6 +233,9 @@ struct tic_mem
     tic80_pixel_color_format screen_format;
 };
 
+// frames of the longest tick output, the fractional part carries over to the next tick
+#define TIC_FRAME_SAMPLES_MAX(samplerate) ((samplerate) / TIC80_FRAMERATE + 2)
+
 tic_mem* tic_core_create(s32 samplerate);
 void tic_core_close(tic_mem* memory);
 void tic_core_pause(tic_mem* memory);
@@ -189,9 +243,28 @@ void tic_core_resume(tic_mem* memory);
 void tic_core_tick_start(tic_mem* memory);
 void tic_core_tick(tic_mem* memory, tic_tick_data* data);
 void tic_core_tick_end(tic_mem* memory);
+void tic_core_offline(tic_mem* memory);
 void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt);
 void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data);
 const tic_script_config* tic_core_script_config(tic_mem* memory);
+u32 tic_core_callback_resolves(tic_mem* memory);
+
+// rebuilds cart.binary from cart.code, clears it when the script has no compiler
+bool tic_core_compile(tic_mem* memory);
+
+// script tick timing since the cart started, a spike is a tick over a millisecond
+// and twice as long as the running average
+typedef struct
+{
+    u32 ticks;
+    u32 spikes;
+    u32 worst;  // us
+    u64 idle;   // us spent in tic_core_idle
+} tic_tick_stats;
+
+// spends up to budget us on script housekeeping (garbage collection), call after the tick
+void tic_core_idle(tic_mem* memory, s32 budget);
+tic_tick_stats tic_core_tick_stats(tic_mem* memory);
 
 typedef struct
 {
@@ -199,4 +272,5 @@ typedef struct
     tic_mem* memory;
     tic_tick_data tickData;
     u64 tick_counter;
+    float* fsamples;
 } tic80_local;
@@ -27,11 +27,31 @@
 #include "tools.h"
 
 #include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "duktape.h"
 
 static const char TicCore[] = "_TIC80";
 
+enum
+{
+    CallbackTick,
+    CallbackScanline,
+    CallbackLegacyScanline,
+    CallbackOverline,
+    CallbackCount
+};
+
+static const char* const CallbackNames[] = {TIC_FN, SCN_FN, "scanline", OVR_FN};
+
+// TIC/SCN/OVR are pinned in the global stash and pushed by heap pointer,
+// the globals are looked up again once per frame after TIC()
+struct tic_js_callbacks
+{
+    void* ptrs[CallbackCount];
+};
+
 static void closeJavascript(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -41,6 +61,9 @@ static void closeJavascript(tic_mem* tic)
         duk_destroy_heap(core->js);
         core->js = NULL;
     }
+
+    free(core->callbacks.js);
+    core->callbacks.js = NULL;
 }
 
 static tic_core* getDukCore(duk_context* duk)
@@ -466,6 +489,33 @@ static duk_ret_t duk_map(duk_context* duk)
     return 0;
 }
 
+static duk_ret_t duk_sprs(duk_context* duk)
+{
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    if(duk_is_buffer_data(duk, 0) || duk_is_string(duk, 0))
+    {
+        duk_size_t size = 0;
+        const void* records = duk_is_string(duk, 0)
+            ? (const void*)duk_get_lstring(duk, 0, &size)
+            : duk_get_buffer_data(duk, 0, &size);
+
+        s32 count = duk_opt_int(duk, 1, (s32)size / TIC_SPRITE_RECORD_SIZE);
+
+        tic_api_sprs(tic, records, (s32)size, count);
+    }
+    else
+    {
+        s32 address = duk_to_int(duk, 0);
+        s32 count = duk_to_int(duk, 1);
+
+        if(address >= 0 && address < sizeof(tic_ram))
+            tic_api_sprs(tic, (const u8*)&tic->ram + address, sizeof(tic_ram) - address, count);
+    }
+
+    return 0;
+}
+
 static duk_ret_t duk_mget(duk_context* duk)
 {
     s32 x = duk_opt_int(duk, 0, 0);
@@ -555,6 +605,113 @@ static duk_ret_t duk_memset(duk_context* duk)
     return 0;
 }
 
+// peekbuf(addr,size) returns a copy of the bytes in a Uint8Array
+static duk_ret_t duk_peekbuf(duk_context* duk)
+{
+    s32 address = duk_to_int(duk, 0);
+    s32 size = duk_to_int(duk, 1);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    if(size < 0 || size > sizeof(tic_ram))
+        return duk_error(duk, DUK_ERR_ERROR, "invalid params, peekbuf(addr,size)\n");
+
+    u8* data = duk_push_fixed_buffer(duk, size);
+
+    if(!tic_api_peekbuf(tic, address, data, size))
+        return duk_error(duk, DUK_ERR_ERROR, "invalid params, peekbuf(addr,size)\n");
+
+    duk_push_buffer_object(duk, -1, 0, size, DUK_BUFOBJ_UINT8ARRAY);
+
+    return 1;
+}
+
+// pokebuf(addr,data) writes a buffer, a typed array, a string or an array of bytes
+static duk_ret_t duk_pokebuf(duk_context* duk)
+{
+    s32 address = duk_to_int(duk, 0);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+    bool done = false;
+
+    if(duk_is_buffer_data(duk, 1) || duk_is_string(duk, 1))
+    {
+        duk_size_t size = 0;
+        const void* data = duk_is_string(duk, 1)
+            ? (const void*)duk_get_lstring(duk, 1, &size)
+            : duk_get_buffer_data(duk, 1, &size);
+
+        done = size <= sizeof(tic_ram) && tic_api_pokebuf(tic, address, data, (s32)size);
+    }
+    else if(duk_is_array(duk, 1))
+    {
+        duk_size_t size = duk_get_length(duk, 1);
+
+        if(size <= sizeof(tic_ram))
+        {
+            u8* data = duk_push_fixed_buffer(duk, size);
+
+            for(duk_uarridx_t i = 0; i < size; i++)
+            {
+                duk_get_prop_index(duk, 1, i);
+                data[i] = duk_to_int(duk, -1);
+                duk_pop(duk);
+            }
+
+            done = tic_api_pokebuf(tic, address, data, (s32)size);
+        }
+    }
+
+    if(!done)
+        return duk_error(duk, DUK_ERR_ERROR, "invalid params, pokebuf(addr,data)\n");
+
+    return 0;
+}
+
+static duk_ret_t duk_memcpy4(duk_context* duk)
+{
+    s32 dest = duk_to_int(duk, 0);
+    s32 src = duk_to_int(duk, 1);
+    s32 size = duk_to_int(duk, 2);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+    tic_api_memcpy4(tic, dest, src, size);
+
+    return 0;
+}
+
+static duk_ret_t duk_memset4(duk_context* duk)
+{
+    s32 dest = duk_to_int(duk, 0);
+    u8 value = duk_to_int(duk, 1);
+    s32 size = duk_to_int(duk, 2);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+    tic_api_memset4(tic, dest, value, size);
+
+    return 0;
+}
+
+// ram() returns a Uint8Array over the RAM range, the engine checks the
+// indices against its length and reads and writes the RAM in place
+static duk_ret_t duk_ram(duk_context* duk)
+{
+    s32 address = duk_opt_int(duk, 0, 0);
+    s32 size = duk_opt_int(duk, 1, (s32)sizeof(tic_ram) - address);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+    u8* data = tic_api_ram(tic, address, size);
+
+    if(!data)
+        return duk_error(duk, DUK_ERR_ERROR, "invalid parameters, ram([addr],[size])\n");
+
+    duk_push_external_buffer(duk);
+    duk_config_buffer(duk, -1, data, size);
+    duk_push_buffer_object(duk, -1, 0, size, DUK_BUFOBJ_UINT8ARRAY);
+
+    return 1;
+}
+
 static duk_ret_t duk_trace(duk_context* duk)
 {
     tic_mem* tic = (tic_mem*)getDukCore(duk);
@@ -704,6 +861,40 @@ static duk_ret_t duk_circb(duk_context* duk)
     return 0;
 }
 
+static duk_ret_t duk_elli(duk_context* duk)
+{
+    s32 a = duk_to_int(duk, 2);
+    s32 b = duk_to_int(duk, 3);
+    if(a < 0 || b < 0) return 0;
+
+    s32 x = duk_to_int(duk, 0);
+    s32 y = duk_to_int(duk, 1);
+    s32 color = duk_to_int(duk, 4);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    tic_api_elli(tic, x, y, a, b, color);
+
+    return 0;
+}
+
+static duk_ret_t duk_ellib(duk_context* duk)
+{
+    s32 a = duk_to_int(duk, 2);
+    s32 b = duk_to_int(duk, 3);
+    if(a < 0 || b < 0) return 0;
+
+    s32 x = duk_to_int(duk, 0);
+    s32 y = duk_to_int(duk, 1);
+    s32 color = duk_to_int(duk, 4);
+
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    tic_api_ellib(tic, x, y, a, b, color);
+
+    return 0;
+}
+
 static duk_ret_t duk_tri(duk_context* duk)
 {
     s32 pt[6];
@@ -760,6 +951,12 @@ static duk_ret_t duk_textri(duk_context* duk)
         }
     }
 
+    float z[3] = {0};
+    bool perspective = !duk_is_null_or_undefined(duk, 16);
+    if(perspective)
+        for (s32 i = 0; i < COUNT_OF(z); i++)
+            z[i] = (float)duk_to_number(duk, i + 14);
+
     tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                         pt[2], pt[3],   //  xy 2
                         pt[4], pt[5],   //  xy 3
@@ -767,7 +964,55 @@ static duk_ret_t duk_textri(duk_context* duk)
                         pt[8], pt[9],   //  uv 2
                         pt[10], pt[11],//  uv 3
                         use_map, // usemap
-                        colors, count);    //  chroma
+                        colors, count,    //  chroma
+                        z[0], z[1], z[2], perspective);
+
+    return 0;
+}
+
+static duk_ret_t duk_mesh(duk_context* duk)
+{
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    static u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
+
+    s32 vertices = duk_to_int(duk, 0);
+    s32 indices = duk_to_int(duk, 1);
+    s32 triangles = duk_to_int(duk, 2);
+    u8 color = duk_to_int(duk, 3);
+    u8 flags = duk_opt_int(duk, 4, 0);
+    s32 uvs = duk_opt_int(duk, 5, -1);
+    bool use_map = duk_opt_boolean(duk, 6, false);
+
+    if(!duk_is_null_or_undefined(duk, 7))
+    {
+        if(duk_is_array(duk, 7))
+        {
+            for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+            {
+                duk_get_prop_index(duk, 7, i);
+                if(duk_is_null_or_undefined(duk, -1))
+                {
+                    duk_pop(duk);
+                    break;
+                }
+                else
+                {
+                    colors[i] = duk_to_int(duk, -1);
+                    count++;
+                    duk_pop(duk);
+                }
+            }
+        }
+        else
+        {
+            colors[0] = duk_to_int(duk, 7);
+            count = 1;
+        }
+    }
+
+    tic_api_mesh(tic, vertices, indices, triangles, color, flags, uvs, use_map, colors, count);
 
     return 0;
 }
@@ -807,6 +1052,21 @@ static duk_ret_t duk_music(duk_context* duk)
     return 0;
 }
 
+static duk_ret_t duk_mpos(duk_context* duk)
+{
+    tic_mem* tic = (tic_mem*)getDukCore(duk);
+
+    tic_music_pos pos = tic_api_mpos(tic);
+
+    duk_idx_t idx = duk_push_array(duk);
+    duk_push_int(duk, pos.tick);
+    duk_put_prop_index(duk, idx, 0);
+    duk_push_int(duk, pos.duration);
+    duk_put_prop_index(duk, idx, 1);
+
+    return 1;
+}
+
 static duk_ret_t duk_sync(duk_context* duk)
 {
     tic_mem* tic = (tic_mem*)getDukCore(duk);
@@ -893,6 +1153,82 @@ static void initDuktape(tic_core* core)
     }
 }
 
+// Duktape bytecode isn't portable between versions and isn't validated on load,
+// so the binary starts with the DUK_VERSION it was dumped by
+
+static bool compileJavascript(const char* code, tic_binary* binary)
+{
+    duk_context* duk = duk_create_heap(NULL, NULL, NULL, NULL, NULL);
+
+    if (!duk) return false;
+
+    bool done = false;
+
+    if (duk_pcompile_string(duk, 0, code) == 0)
+    {
+        duk_dump_function(duk);
+
+        duk_size_t size = 0;
+        const u8* dump = duk_get_buffer_data(duk, -1, &size);
+
+        u32 version = DUK_VERSION;
+        u8* data = malloc(sizeof version + size);
+
+        if (data)
+        {
+            memcpy(data, &version, sizeof version);
+            memcpy(data + sizeof version, dump, size);
+
+            done = tic_tool_pack_binary(binary, code, data, (s32)(sizeof version + size));
+
+            free(data);
+        }
+    }
+
+    duk_destroy_heap(duk);
+
+    return done;
+}
+
+static duk_ret_t loadJsFunction(duk_context* duk, void* udata)
+{
+    duk_load_function(duk);
+    return 1;
+}
+
+// pushes the program function from the cart binary built from this code,
+// Duktape doesn't validate loaded bytecode, an untrusted binary is never loaded
+static bool loadJsBinary(duk_context* duk, const tic_binary* binary, const char* code)
+{
+    if (!binary->trusted) return false;
+
+    s32 size = 0;
+    u8* data = tic_tool_unpack_binary(binary, code, &size);
+
+    if (!data) return false;
+
+    u32 version = 0;
+    bool done = false;
+
+    if (size > (s32)sizeof version)
+        memcpy(&version, data, sizeof version);
+
+    if (version == DUK_VERSION)
+    {
+        size -= sizeof version;
+        memcpy(duk_push_fixed_buffer(duk, size), data + sizeof version, size);
+
+        done = duk_safe_call(duk, loadJsFunction, NULL, 1, 1) == DUK_EXEC_SUCCESS;
+
+        if (!done)
+            duk_pop(duk);
+    }
+
+    free(data);
+
+    return done;
+}
+
 static bool initJavascript(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
@@ -900,13 +1236,65 @@ static bool initJavascript(tic_mem* tic, const char* code)
     initDuktape(core);
     duk_context* duktape = core->js;
 
-    if (duk_pcompile_string(duktape, 0, code) != 0 || duk_peval_string(duktape, code) != 0)
+    // the program is compiled once and called, eval would compile it again
+    if ((!loadJsBinary(duktape, &tic->cart.binary, code) && duk_pcompile_string(duktape, 0, code) != 0)
+        || duk_pcall(duktape, 0) != DUK_EXEC_SUCCESS)
     {
         core->data->error(core->data->data, duk_safe_to_stacktrace(duktape, -1));
         duk_pop(duktape);
         return false;
     }
 
+    duk_pop(duktape);
+
+    return true;
+}
+
+static void resolveJsCallbacks(tic_core* core)
+{
+    duk_context* duk = core->js;
+    struct tic_js_callbacks* callbacks = core->callbacks.js;
+
+    if(!callbacks)
+    {
+        callbacks = core->callbacks.js = calloc(1, sizeof(struct tic_js_callbacks));
+
+        if(!callbacks) return;
+    }
+
+    for(s32 i = 0; i < CallbackCount; i++)
+    {
+        duk_get_global_string(duk, CallbackNames[i]);
+        void* ptr = duk_is_function(duk, -1) ? duk_get_heapptr(duk, -1) : NULL;
+
+        if(ptr != callbacks->ptrs[i])
+        {
+            // the stash keeps the cached function reachable
+            duk_push_global_stash(duk);
+
+            if(ptr) duk_dup(duk, -2);
+            else duk_push_undefined(duk);
+
+            duk_put_prop_string(duk, -2, CallbackNames[i]);
+            duk_pop(duk);
+
+            callbacks->ptrs[i] = ptr;
+            core->callbackResolves++;
+        }
+
+        duk_pop(duk);
+    }
+}
+
+static bool pushJsCallback(tic_core* core, s32 index)
+{
+    if(!core->callbacks.js)
+        resolveJsCallbacks(core);
+
+    if(!core->callbacks.js || !core->callbacks.js->ptrs[index])
+        return false;
+
+    duk_push_heapptr(core->js, core->callbacks.js->ptrs[index]);
     return true;
 }
 
@@ -920,41 +1308,43 @@ static void callJavascriptTick(tic_mem* tic)
 
     if(duk)
     {
-        if(duk_get_global_string(duk, TIC_FN))
+        if(pushJsCallback(core, CallbackTick))
         {
             if(duk_pcall(duk, 0) != DUK_EXEC_SUCCESS)
             {
                 core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
             }
+
+            duk_pop(duk);
         }
         else core->data->error(core->data->data, "'function TIC()...' isn't found :(");
 
-        duk_pop(duk);
+        resolveJsCallbacks(core);
     }
 }
 
-static void callJavascriptScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callJavascriptScanlineCallback(tic_mem* tic, s32 row, void* data, s32 index)
 {
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, name))
+    if(duk && pushJsCallback(core, index))
     {
         duk_push_int(duk, row);
 
         if(duk_pcall(duk, 1) != 0)
             core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
-    }
 
-    duk_pop(duk);
+        duk_pop(duk);
+    }
 }
 
 static void callJavascriptScanline(tic_mem* tic, s32 row, void* data)
 {
-    callJavascriptScanlineName(tic, row, data, SCN_FN);
+    callJavascriptScanlineCallback(tic, row, data, CallbackScanline);
 
     // try to call old scanline
-    callJavascriptScanlineName(tic, row, data, "scanline");
+    callJavascriptScanlineCallback(tic, row, data, CallbackLegacyScanline);
 }
 
 static void callJavascriptOverline(tic_mem* tic, void* data)
@@ -962,13 +1352,13 @@ static void callJavascriptOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, OVR_FN))
+    if(duk && pushJsCallback(core, CallbackOverline))
     {
         if(duk_pcall(duk, 0) != 0)
             core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
-    }
 
-    duk_pop(duk);
+        duk_pop(duk);
+    }
 }
 
 static const char* const JsKeywords [] =
@@ -1056,6 +1446,8 @@ static const tic_script_config JsSyntaxConfig =
 
     .getOutline         = getJsOutline,
     .eval               = evalJs,
+    .compile            = compileJavascript,
+    .compiler           = "duktape",
 
     .blockCommentStart  = "/*",
     .blockCommentEnd    = "*/",
@@ -25,6 +25,7 @@
 #if defined(TIC_BUILD_WITH_LUA)
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <lua.h>
 #include <lauxlib.h>
@@ -35,6 +36,24 @@
 
 static const char TicCore[] = "_TIC80";
 
+enum
+{
+    CallbackTick,
+    CallbackScanline,
+    CallbackLegacyScanline,
+    CallbackOverline,
+    CallbackCount
+};
+
+static const char* const CallbackNames[] = {TIC_FN, SCN_FN, "scanline", OVR_FN};
+
+// TIC/SCN/OVR are kept as registry refs, carts often swap them from TIC(),
+// so the globals are looked up again once per frame instead of on every call
+struct tic_lua_callbacks
+{
+    s32 refs[CallbackCount];
+};
+
 s32 luaopen_lpeg(lua_State *lua);
 
 // !TODO: get rid of this wrap
@@ -269,6 +288,52 @@ static s32 lua_circb(lua_State* lua)
     return 0;
 }
 
+static s32 lua_elli(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top == 5)
+    {
+        s32 a = getLuaNumber(lua, 3);
+        s32 b = getLuaNumber(lua, 4);
+        if(a < 0 || b < 0) return 0;
+
+        s32 x = getLuaNumber(lua, 1);
+        s32 y = getLuaNumber(lua, 2);
+        s32 color = getLuaNumber(lua, 5);
+
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+        tic_api_elli(tic, x, y, a, b, color);
+    }
+    else luaL_error(lua, "invalid parameters, elli(x,y,a,b,color)\n");
+
+    return 0;
+}
+
+static s32 lua_ellib(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top == 5)
+    {
+        s32 a = getLuaNumber(lua, 3);
+        s32 b = getLuaNumber(lua, 4);
+        if(a < 0 || b < 0) return 0;
+
+        s32 x = getLuaNumber(lua, 1);
+        s32 y = getLuaNumber(lua, 2);
+        s32 color = getLuaNumber(lua, 5);
+
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+        tic_api_ellib(tic, x, y, a, b, color);
+    }
+    else luaL_error(lua, "invalid parameters, ellib(x,y,a,b,color)\n");
+
+    return 0;
+}
+
 static s32 lua_tri(lua_State* lua)
 {
     s32 top = lua_gettop(lua);
@@ -338,6 +403,13 @@ static s32 lua_textri(lua_State* lua)
             }
         }
 
+        //  check for perspective z
+        float z[3] = {0};
+        bool perspective = top >= 17;
+        if(perspective)
+            for (s32 i = 0; i < COUNT_OF(z); i++)
+                z[i] = (float)lua_tonumber(lua, i + 15);
+
         tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                                     pt[2], pt[3],   //  xy 2
                                     pt[4], pt[5],   //  xy 3
@@ -345,9 +417,62 @@ static s32 lua_textri(lua_State* lua)
                                     pt[8], pt[9],   //  uv 2
                                     pt[10], pt[11], //  uv 3
                                     use_map,        // use map
-                                    colors, count);        // chroma
+                                    colors, count,  // chroma
+                                    z[0], z[1], z[2], perspective);
+    }
+    else luaL_error(lua, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off],[z1,z2,z3])\n");
+    return 0;
+}
+
+static s32 lua_mesh(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+    tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+    if(top >= 4)
+    {
+        static u8 colors[TIC_PALETTE_SIZE];
+        s32 count = 0;
+
+        s32 vertices = getLuaNumber(lua, 1);
+        s32 indices = getLuaNumber(lua, 2);
+        s32 triangles = getLuaNumber(lua, 3);
+        u8 color = getLuaNumber(lua, 4);
+        u8 flags = top >= 5 ? getLuaNumber(lua, 5) : 0;
+        s32 uvs = top >= 6 ? getLuaNumber(lua, 6) : -1;
+        bool use_map = top >= 7 ? lua_toboolean(lua, 7) : false;
+
+        if(top >= 8)
+        {
+            if(lua_istable(lua, 8))
+            {
+                for(s32 i = 1; i <= TIC_PALETTE_SIZE; i++)
+                {
+                    lua_rawgeti(lua, 8, i);
+                    if(lua_isnumber(lua, -1))
+                    {
+                        colors[i-1] = getLuaNumber(lua, -1);
+                        count++;
+                        lua_pop(lua, 1);
+                    }
+                    else
+                    {
+                        lua_pop(lua, 1);
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                colors[0] = getLuaNumber(lua, 8);
+                count = 1;
+            }
+        }
+
+        tic_api_mesh(tic, vertices, indices, triangles, color, flags, uvs, use_map, colors, count);
     }
-    else luaL_error(lua, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off])\n");
+    else luaL_error(lua, "invalid parameters, mesh(vaddr,iaddr,count,color,[flags=0],[uvaddr=-1],[use_map=false],[chroma=off])\n");
+
     return 0;
 }
 
@@ -517,6 +642,32 @@ static s32 lua_spr(lua_State* lua)
     return 0;
 }
 
+static s32 lua_sprs(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+    tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+    if(top >= 1 && lua_type(lua, 1) == LUA_TSTRING)
+    {
+        size_t size = 0;
+        const char* records = lua_tolstring(lua, 1, &size);
+        s32 count = top >= 2 ? getLuaNumber(lua, 2) : (s32)size / TIC_SPRITE_RECORD_SIZE;
+
+        tic_api_sprs(tic, (const u8*)records, (s32)size, count);
+    }
+    else if(top == 2)
+    {
+        s32 address = getLuaNumber(lua, 1);
+        s32 count = getLuaNumber(lua, 2);
+
+        if(address >= 0 && address < sizeof(tic_ram))
+            tic_api_sprs(tic, (const u8*)&tic->ram + address, sizeof(tic_ram) - address, count);
+    }
+    else luaL_error(lua, "invalid parameters, sprs(addr,count) or sprs(buffer,[count])\n");
+
+    return 0;
+}
+
 static s32 lua_mget(lua_State* lua)
 {
     s32 top = lua_gettop(lua);
@@ -705,6 +856,18 @@ static s32 lua_music(lua_State* lua)
     return 0;
 }
 
+static s32 lua_mpos(lua_State* lua)
+{
+    tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+    tic_music_pos pos = tic_api_mpos(tic);
+
+    lua_pushinteger(lua, pos.tick);
+    lua_pushinteger(lua, pos.duration);
+
+    return 2;
+}
+
 static s32 lua_sfx(lua_State* lua)
 {
     s32 top = lua_gettop(lua);
@@ -766,7 +929,8 @@ static s32 lua_sfx(lua_State* lua)
                             {
                                 for(s32 i = 0; i < COUNT_OF(volumes); i++)
                                 {
-                                    volumes[i] = lua_rawgeti(lua, 5, i + 1);
+                                    lua_rawgeti(lua, 5, i + 1);
+                                    volumes[i] = getLuaNumber(lua, -1);
                                     lua_pop(lua, 1);
                                 }
                             }
@@ -945,6 +1109,256 @@ static s32 lua_memset(lua_State* lua)
     return 0;
 }
 
+// peekbuf(addr,size) returns the bytes as a string
+static s32 lua_peekbuf(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top == 2)
+    {
+        s32 address = getLuaNumber(lua, 1);
+        s32 size = getLuaNumber(lua, 2);
+
+        u8* data = size >= 0 && size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+        if(data)
+        {
+            tic_mem* tic = (tic_mem*)getLuaCore(lua);
+            bool done = tic_api_peekbuf(tic, address, data, size);
+
+            if(done)
+                lua_pushlstring(lua, (const char*)data, size);
+
+            free(data);
+
+            if(done)
+                return 1;
+        }
+    }
+
+    luaL_error(lua, "invalid params, peekbuf(addr,size)\n");
+
+    return 0;
+}
+
+// pokebuf(addr,data) writes a string or a table of bytes
+static s32 lua_pokebuf(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+    bool done = false;
+
+    if(top == 2)
+    {
+        s32 address = getLuaNumber(lua, 1);
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+        if(lua_type(lua, 2) == LUA_TSTRING)
+        {
+            size_t size = 0;
+            const char* data = lua_tolstring(lua, 2, &size);
+
+            done = size <= sizeof(tic_ram) && tic_api_pokebuf(tic, address, (const u8*)data, (s32)size);
+        }
+        else if(lua_istable(lua, 2))
+        {
+            size_t size = lua_rawlen(lua, 2);
+            u8* data = size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+            if(data)
+            {
+                for(s32 i = 0; i < size; i++)
+                {
+                    lua_rawgeti(lua, 2, i + 1);
+                    data[i] = getLuaNumber(lua, -1);
+                    lua_pop(lua, 1);
+                }
+
+                done = tic_api_pokebuf(tic, address, data, (s32)size);
+                free(data);
+            }
+        }
+    }
+
+    if(!done)
+        luaL_error(lua, "invalid params, pokebuf(addr,data)\n");
+
+    return 0;
+}
+
+static s32 lua_memcpy4(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top == 3)
+    {
+        s32 dest = getLuaNumber(lua, 1);
+        s32 src = getLuaNumber(lua, 2);
+        s32 size = getLuaNumber(lua, 3);
+
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+        tic_api_memcpy4(tic, dest, src, size);
+    }
+    else luaL_error(lua, "invalid params, memcpy4(dest,src,size)\n");
+
+    return 0;
+}
+
+static s32 lua_memset4(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+
+    if(top == 3)
+    {
+        s32 dest = getLuaNumber(lua, 1);
+        u8 value = getLuaNumber(lua, 2);
+        s32 size = getLuaNumber(lua, 3);
+
+        tic_mem* tic = (tic_mem*)getLuaCore(lua);
+        tic_api_memset4(tic, dest, value, size);
+    }
+    else luaL_error(lua, "invalid params, memset4(dest,val,size)\n");
+
+    return 0;
+}
+
+// ram() views are userdata over the RAM range, indexed from 0,
+// the range is checked once when the view is made
+static const char RamView[] = "TicRamView";
+
+typedef struct
+{
+    u8* data;
+    s32 size;
+} LuaRamView;
+
+static s32 lua_ram(lua_State* lua)
+{
+    s32 top = lua_gettop(lua);
+    tic_mem* tic = (tic_mem*)getLuaCore(lua);
+
+    s32 address = top >= 1 ? getLuaNumber(lua, 1) : 0;
+    s32 size = top >= 2 ? getLuaNumber(lua, 2) : (s32)sizeof(tic_ram) - address;
+
+    u8* data = tic_api_ram(tic, address, size);
+
+    if(data)
+    {
+        LuaRamView* view = lua_newuserdata(lua, sizeof(LuaRamView));
+        view->data = data;
+        view->size = size;
+
+        luaL_getmetatable(lua, RamView);
+        lua_setmetatable(lua, -2);
+
+        return 1;
+    }
+    else luaL_error(lua, "invalid parameters, ram([addr],[size])\n");
+
+    return 0;
+}
+
+static s32 lua_ramview_index(lua_State* lua)
+{
+    LuaRamView* view = luaL_checkudata(lua, 1, RamView);
+
+    if(lua_type(lua, 2) == LUA_TNUMBER)
+    {
+        s32 index = getLuaNumber(lua, 2);
+
+        if((u32)index < (u32)view->size)
+            lua_pushinteger(lua, view->data[index]);
+        else lua_pushnil(lua);
+    }
+    else
+    {
+        // methods live in the metatable
+        lua_getmetatable(lua, 1);
+        lua_pushvalue(lua, 2);
+        lua_rawget(lua, -2);
+    }
+
+    return 1;
+}
+
+static s32 lua_ramview_newindex(lua_State* lua)
+{
+    LuaRamView* view = luaL_checkudata(lua, 1, RamView);
+    s32 index = getLuaNumber(lua, 2);
+
+    if((u32)index < (u32)view->size)
+        view->data[index] = getLuaNumber(lua, 3);
+    else luaL_error(lua, "ram view index out of range\n");
+
+    return 0;
+}
+
+static s32 lua_ramview_len(lua_State* lua)
+{
+    LuaRamView* view = luaL_checkudata(lua, 1, RamView);
+    lua_pushinteger(lua, view->size);
+
+    return 1;
+}
+
+// view:read([offset],[size]) returns the bytes as a string
+static s32 lua_ramview_read(lua_State* lua)
+{
+    LuaRamView* view = luaL_checkudata(lua, 1, RamView);
+    s32 top = lua_gettop(lua);
+
+    s32 offset = top >= 2 ? getLuaNumber(lua, 2) : 0;
+    s32 size = top >= 3 ? getLuaNumber(lua, 3) : view->size - offset;
+
+    if(offset >= 0 && size >= 0 && offset <= view->size - size)
+    {
+        lua_pushlstring(lua, (const char*)view->data + offset, size);
+        return 1;
+    }
+    else luaL_error(lua, "invalid parameters, view:read([offset],[size])\n");
+
+    return 0;
+}
+
+// view:write(offset,string) copies the string in
+static s32 lua_ramview_write(lua_State* lua)
+{
+    LuaRamView* view = luaL_checkudata(lua, 1, RamView);
+
+    size_t size = 0;
+    s32 offset = getLuaNumber(lua, 2);
+    const char* data = lua_tolstring(lua, 3, &size);
+
+    if(data && offset >= 0 && offset <= view->size && size <= (size_t)(view->size - offset))
+        memcpy(view->data + offset, data, size);
+    else luaL_error(lua, "invalid parameters, view:write(offset,string)\n");
+
+    return 0;
+}
+
+static void initRamView(lua_State* lua)
+{
+    static const luaL_Reg Methods[] =
+    {
+        { "__index", lua_ramview_index },
+        { "__newindex", lua_ramview_newindex },
+        { "__len", lua_ramview_len },
+        { "read", lua_ramview_read },
+        { "write", lua_ramview_write },
+        { NULL, NULL }
+    };
+
+    if(luaL_newmetatable(lua, RamView))
+    {
+        for (const luaL_Reg *method = Methods; method->func; method++)
+        {
+            lua_pushcfunction(lua, method->func);
+            lua_setfield(lua, -2, method->name);
+        }
+    }
+
+    lua_pop(lua, 1);
+}
+
 static const char* printString(lua_State* lua, s32 index)
 {
     lua_getglobal(lua, "tostring");
@@ -1292,37 +1706,536 @@ static void initAPI(tic_core* core)
     registerLuaFunction(core, lua_dofile, "dofile");
     registerLuaFunction(core, lua_loadfile, "loadfile");
 
+    initRamView(core->lua);
+
     lua_sethook(core->lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
 }
 
-static void closeLua(tic_mem* tic)
+// Every VM allocates from its own heap: blocks up to LuaHeapSmall bytes are cut
+// from pages into size classes of LuaHeapAlign bytes and recycled through per
+// class free lists, bigger ones go to malloc. Lua passes the old size of every
+// block back, so the class of a freed block needs no header.
+
+enum
 {
-    tic_core* core = (tic_core*)tic;
+    LuaHeapAlign = 16,
+    LuaHeapClasses = 16,
+    LuaHeapSmall = LuaHeapAlign * LuaHeapClasses,
+    LuaHeapPage = 64 * 1024,
+};
 
-    if(core->lua)
-    {
-        lua_close(core->lua);
-        core->lua = NULL;
+typedef struct LuaHeapBlock
+{
+    struct LuaHeapBlock* next;
+} LuaHeapBlock;
+
+typedef struct
+{
+    LuaHeapBlock* free[LuaHeapClasses];
+    LuaHeapBlock* pages;
+
+    u8* cursor;
+    u8* end;
+} LuaHeap;
+
+static inline s32 luaHeapClass(size_t size)
+{
+    return size && size <= LuaHeapSmall ? (s32)((size - 1) / LuaHeapAlign) : -1;
+}
+
+static void* luaHeapGet(LuaHeap* heap, s32 index)
+{
+    LuaHeapBlock* block = heap->free[index];
+
+    if(block)
+    {
+        heap->free[index] = block->next;
+        return block;
     }
+
+    size_t size = (index + 1) * LuaHeapAlign;
+
+    if((size_t)(heap->end - heap->cursor) < size)
+    {
+        // the page header takes a whole class slot to keep the blocks aligned
+        LuaHeapBlock* page = malloc(LuaHeapPage);
+
+        if(!page) return NULL;
+
+        page->next = heap->pages;
+        heap->pages = page;
+        heap->cursor = (u8*)page + LuaHeapAlign;
+        heap->end = (u8*)page + LuaHeapPage;
+    }
+
+    void* ptr = heap->cursor;
+    heap->cursor += size;
+
+    return ptr;
 }
 
-static bool initLua(tic_mem* tic, const char* code)
+static inline void luaHeapPut(LuaHeap* heap, s32 index, void* ptr)
+{
+    LuaHeapBlock* block = ptr;
+    block->next = heap->free[index];
+    heap->free[index] = block;
+}
+
+static void* luaHeapAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    LuaHeap* heap = ud;
+
+    // osize is the type of a new object when ptr is NULL
+    s32 from = ptr ? luaHeapClass(osize) : -1;
+    s32 to = luaHeapClass(nsize);
+
+    if(nsize == 0)
+    {
+        if(from >= 0) luaHeapPut(heap, from, ptr);
+        else free(ptr);
+
+        return NULL;
+    }
+
+    if(ptr && from >= 0 && from == to)
+        return ptr;
+
+    void* block = from < 0 && to < 0
+        ? realloc(ptr, nsize)
+        : to >= 0 ? luaHeapGet(heap, to) : malloc(nsize);
+
+    // Lua expects a shrink to always succeed, the old block is big enough
+    if(!block)
+        return ptr && nsize <= osize ? ptr : NULL;
+
+    if(ptr && (from >= 0 || to >= 0))
+    {
+        memcpy(block, ptr, osize < nsize ? osize : nsize);
+
+        if(from >= 0) luaHeapPut(heap, from, ptr);
+        else free(ptr);
+    }
+
+    return block;
+}
+
+static s32 luaHeapPanic(lua_State* lua)
+{
+    fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n", lua_tostring(lua, -1));
+    return 0;
+}
+
+static lua_State* newLuaState()
+{
+    LuaHeap* heap = calloc(1, sizeof(LuaHeap));
+
+    if(!heap) return NULL;
+
+    lua_State* lua = lua_newstate(luaHeapAlloc, heap);
+
+    if(lua) lua_atpanic(lua, luaHeapPanic);
+    else free(heap);
+
+    return lua;
+}
+
+static void closeLuaState(lua_State* lua)
+{
+    void* ud = NULL;
+    lua_getallocf(lua, &ud);
+    lua_close(lua);
+
+    LuaHeap* heap = ud;
+
+    for(LuaHeapBlock* page = heap->pages; page;)
+    {
+        LuaHeapBlock* next = page->next;
+        free(page);
+        page = next;
+    }
+
+    free(heap);
+}
+
+static void closeLua(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
 
-    closeLua(tic);
+    if(core->lua)
+    {
+        closeLuaState(core->lua);
+        core->lua = NULL;
+    }
+
+    free(core->callbacks.lua);
+    core->callbacks.lua = NULL;
+}
+
+// A Lua VM is kept warm between runs: builtins and API bindings stay loaded.
+// The fields and metatables of _G, of the tables it holds and of their
+// subtables (package.loaded, string, math...) are copied after warm up and
+// put back before the next cart is compiled. Anything deeper, upvalues and
+// the registry aren't restored. That is enough for the Lua builtins, but the
+// Moonscript and Fennel compilers keep their state in upvalues, so their
+// carts get a fresh VM every run.
+
+enum
+{
+    LuaVmLua = 1,
+    LuaVmMoonscript,
+    LuaVmFennel,
+};
+
+#define LUA_SNAPSHOT_DEPTH 2
+
+// the addresses are the registry keys
+static char LuaVmKind;
+static char LuaVmSnapshot;
+static char LuaVmMetatables;
+static char LuaVmStringMeta;
+
+static void snapshotLuaTable(lua_State* lua, s32 snapshot, s32 index, s32 depth)
+{
+    index = lua_absindex(lua, index);
+
+    lua_pushvalue(lua, index);
+    bool done = lua_rawget(lua, snapshot) != LUA_TNIL;
+    lua_pop(lua, 1);
+
+    if(done) return;
+
+    lua_newtable(lua);
+    s32 copy = lua_gettop(lua);
+
+    for(lua_pushnil(lua); lua_next(lua, index); lua_pop(lua, 1))
+    {
+        lua_pushvalue(lua, -2);
+        lua_pushvalue(lua, -2);
+        lua_rawset(lua, copy);
+
+        if(depth && lua_type(lua, -1) == LUA_TTABLE)
+            snapshotLuaTable(lua, snapshot, -1, depth - 1);
+    }
+
+    lua_pushvalue(lua, index);
+    lua_insert(lua, -2);
+    lua_rawset(lua, snapshot);
+}
+
+static void snapshotLua(lua_State* lua, s32 kind)
+{
+    lua_newtable(lua);
+    s32 snapshot = lua_gettop(lua);
+
+    lua_pushglobaltable(lua);
+    snapshotLuaTable(lua, snapshot, -1, LUA_SNAPSHOT_DEPTH);
+    lua_pop(lua, 1);
+
+    lua_pushliteral(lua, "");
+    if(lua_getmetatable(lua, -1))
+    {
+        snapshotLuaTable(lua, snapshot, -1, 0);
+        lua_rawsetp(lua, LUA_REGISTRYINDEX, &LuaVmStringMeta);
+    }
+    lua_pop(lua, 1);
+
+    // the metatable of every copied table, false when it has none
+    lua_newtable(lua);
+    s32 metatables = lua_gettop(lua);
+
+    for(lua_pushnil(lua); lua_next(lua, snapshot); lua_pop(lua, 1))
+    {
+        lua_pushvalue(lua, -2);
+
+        if(!lua_getmetatable(lua, -1))
+            lua_pushboolean(lua, false);
+
+        lua_rawset(lua, metatables);
+    }
+
+    lua_rawsetp(lua, LUA_REGISTRYINDEX, &LuaVmMetatables);
+    lua_rawsetp(lua, LUA_REGISTRYINDEX, &LuaVmSnapshot);
+
+    lua_pushinteger(lua, kind);
+    lua_rawsetp(lua, LUA_REGISTRYINDEX, &LuaVmKind);
+}
+
+static void restoreLuaTables(lua_State* lua)
+{
+    lua_rawgetp(lua, LUA_REGISTRYINDEX, &LuaVmSnapshot);
+    s32 snapshot = lua_gettop(lua);
+
+    for(lua_pushnil(lua); lua_next(lua, snapshot); lua_pop(lua, 1))
+    {
+        s32 copy = lua_gettop(lua);
+        s32 table = copy - 1;
+
+        // drop what the cart added, clearing fields while traversing is allowed
+        for(lua_pushnil(lua); lua_next(lua, table); )
+        {
+            lua_pop(lua, 1);
+            lua_pushvalue(lua, -1);
+
+            if(lua_rawget(lua, copy) == LUA_TNIL)
+            {
+                lua_pushvalue(lua, -2);
+                lua_pushnil(lua);
+                lua_rawset(lua, table);
+            }
+
+            lua_pop(lua, 1);
+        }
+
+        for(lua_pushnil(lua); lua_next(lua, copy); )
+        {
+            lua_pushvalue(lua, -2);
+            lua_insert(lua, -2);
+            lua_rawset(lua, table);
+        }
+    }
+
+    lua_pop(lua, 1);
+
+    lua_rawgetp(lua, LUA_REGISTRYINDEX, &LuaVmMetatables);
+    s32 metatables = lua_gettop(lua);
+
+    for(lua_pushnil(lua); lua_next(lua, metatables); lua_pop(lua, 1))
+    {
+        lua_pushvalue(lua, -2);
+
+        if(lua_istable(lua, -2))
+            lua_pushvalue(lua, -2);
+        else lua_pushnil(lua);
+
+        lua_setmetatable(lua, -2);
+        lua_pop(lua, 1);
+    }
+
+    lua_pop(lua, 1);
+}
+
+static void resetLua(tic_core* core)
+{
+    lua_State* lua = core->lua;
+
+    lua_settop(lua, 0);
+
+    restoreLuaTables(lua);
+
+    lua_pushliteral(lua, "");
+    lua_rawgetp(lua, LUA_REGISTRYINDEX, &LuaVmStringMeta);
+    lua_setmetatable(lua, -2);
+    lua_pop(lua, 1);
+
+    if(core->callbacks.lua)
+    {
+        for(s32 i = 0; i < CallbackCount; i++)
+            luaL_unref(lua, LUA_REGISTRYINDEX, core->callbacks.lua->refs[i]);
+
+        free(core->callbacks.lua);
+        core->callbacks.lua = NULL;
+    }
+
+    // the previous cart could have stopped the collector or replaced the hook,
+    // 200 are the Lua defaults for the pause and the step multiplier
+    lua_gc(lua, LUA_GCRESTART, 0);
+    lua_gc(lua, LUA_GCSETPAUSE, 200);
+    lua_gc(lua, LUA_GCSETSTEPMUL, 200);
+    lua_gc(lua, LUA_GCCOLLECT, 0);
+
+    lua_sethook(lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
+}
+
+static bool isLuaVmKind(lua_State* lua, s32 kind)
+{
+    lua_rawgetp(lua, LUA_REGISTRYINDEX, &LuaVmKind);
+    bool same = lua_tointeger(lua, -1) == kind;
+    lua_pop(lua, 1);
+
+    return same;
+}
+
+// returns a clean VM of the given kind, preload runs once per new VM
+static lua_State* warmLua(tic_core* core, s32 kind, bool(*preload)(tic_core*))
+{
+    if(core->lua)
+    {
+        if(kind == LuaVmLua && isLuaVmKind(core->lua, kind))
+        {
+            resetLua(core);
+            return core->lua;
+        }
+
+        closeLua((tic_mem*)core);
+    }
+
+    lua_State* lua = core->lua = newLuaState();
+
+    if(!lua)
+    {
+        core->data->error(core->data->data, "not enough memory for the Lua state");
+        return NULL;
+    }
 
-    lua_State* lua = core->lua = luaL_newstate();
     lua_open_builtins(lua);
 
     initAPI(core);
 
+    if(preload && !preload(core))
+    {
+        closeLua((tic_mem*)core);
+        return NULL;
+    }
+
+    lua_settop(lua, 0);
+
+    if(kind == LuaVmLua)
+        snapshotLua(lua, kind);
+
+    return lua;
+}
+
+typedef struct
+{
+    u8* data;
+    s32 size;
+    s32 capacity;
+} LuaDump;
+
+static s32 writeLuaDump(lua_State* lua, const void* data, size_t size, void* ud)
+{
+    LuaDump* dump = ud;
+
+    if(dump->size + (s32)size > dump->capacity)
+    {
+        s32 capacity = MAX(dump->capacity * 2, dump->size + (s32)size);
+        u8* buffer = realloc(dump->data, capacity);
+
+        if(!buffer) return 1;
+
+        dump->data = buffer;
+        dump->capacity = capacity;
+    }
+
+    memcpy(dump->data + dump->size, data, size);
+    dump->size += (s32)size;
+
+    return 0;
+}
+
+// debug info is kept, errors from the binary read the same as from the source
+static bool dumpLuaFunction(lua_State* lua, const char* code, tic_binary* binary)
+{
+    LuaDump dump = {0};
+
+    bool done = lua_isfunction(lua, -1)
+        && lua_dump(lua, writeLuaDump, &dump, 0) == 0
+        && tic_tool_pack_binary(binary, code, dump.data, dump.size);
+
+    free(dump.data);
+
+    return done;
+}
+
+static bool compileLua(const char* code, tic_binary* binary)
+{
+    lua_State* lua = newLuaState();
+
+    if(!lua) return false;
+
+    bool done = luaL_loadbufferx(lua, code, strlen(code), code, "t") == LUA_OK
+        && dumpLuaFunction(lua, code, binary);
+
+    closeLuaState(lua);
+
+    return done;
+}
+
+// pushes the binary when it was built from this code by a compatible VM,
+// Lua rejects a dump of another version or number format but doesn't verify
+// the bytecode, an untrusted binary is never loaded
+static bool loadLuaBinary(lua_State* lua, const tic_binary* binary, const char* code)
+{
+    if(!binary->trusted)
+        return false;
+
+    s32 size = 0;
+    char* data = tic_tool_unpack_binary(binary, code, &size);
+
+    if(data)
+    {
+        s32 status = luaL_loadbufferx(lua, data, size, code, "b");
+        free(data);
+
+        if(status == LUA_OK)
+            return true;
+
+        lua_pop(lua, 1);
+    }
+
+    return false;
+}
+
+static bool loadLuaCode(lua_State* lua, const tic_binary* binary, const char* code)
+{
+    // the code is loaded as text only, a dump in the code chunk would bypass the binary check
+    return loadLuaBinary(lua, binary, code) || luaL_loadbufferx(lua, code, strlen(code), code, "t") == LUA_OK;
+}
+
+// runs the cart binary built from this code, the compiler is skipped
+static bool runLuaBinary(tic_core* core, const char* code, bool* done)
+{
+    lua_State* lua = core->lua;
+
+    if(!loadLuaBinary(lua, &core->memory.cart.binary, code))
+        return false;
+
+    *done = lua_pcall(lua, 0, 0, 0) == LUA_OK;
+
+    if(!*done)
+        core->data->error(core->data->data, lua_tostring(lua, -1));
+
+    return true;
+}
+
+// the transpiled languages run the code through their compiler in a scratch VM,
+// the compile snippet takes the code and returns the loaded Lua function
+static bool compileTranspiled(const char* code, tic_binary* binary, bool(*loadCompiler)(lua_State*), const char* src, const char* name)
+{
+    lua_State* lua = newLuaState();
+
+    if(!lua) return false;
+
+    lua_open_builtins(lua);
+
+    bool done = false;
+
+    if(loadCompiler(lua) && luaL_loadbuffer(lua, src, strlen(src), name) == LUA_OK)
+    {
+        lua_pushstring(lua, code);
+
+        done = lua_pcall(lua, 1, 1, 0) == LUA_OK
+            && dumpLuaFunction(lua, code, binary);
+    }
+
+    closeLuaState(lua);
+
+    return done;
+}
+
+static bool initLua(tic_mem* tic, const char* code)
+{
+    tic_core* core = (tic_core*)tic;
+
+    if(!warmLua(core, LuaVmLua, NULL))
+        return false;
+
     {
         lua_State* lua = core->lua;
 
         lua_settop(lua, 0);
 
-        if(luaL_loadstring(lua, code) != LUA_OK || lua_pcall(lua, 0, LUA_MULTRET, 0) != LUA_OK)
+        if(!loadLuaCode(lua, &tic->cart.binary, code) || lua_pcall(lua, 0, LUA_MULTRET, 0) != LUA_OK)
         {
             core->data->error(core->data->data, lua_tostring(lua, -1));
             return false;
@@ -1367,6 +2280,67 @@ static s32 docall (lua_State *lua, s32 narg, s32 nres)
     return status;
 }
 
+static void resolveLuaCallbacks(tic_core* core)
+{
+    lua_State* lua = core->lua;
+    struct tic_lua_callbacks* callbacks = core->callbacks.lua;
+
+    if(!callbacks)
+    {
+        callbacks = core->callbacks.lua = malloc(sizeof(struct tic_lua_callbacks));
+
+        if(!callbacks) return;
+
+        for(s32 i = 0; i < CallbackCount; i++)
+            callbacks->refs[i] = LUA_NOREF;
+    }
+
+    for(s32 i = 0; i < CallbackCount; i++)
+    {
+        s32* ref = &callbacks->refs[i];
+
+        lua_getglobal(lua, CallbackNames[i]);
+
+        if(!lua_isfunction(lua, -1))
+        {
+            lua_pop(lua, 1);
+            lua_pushnil(lua);
+        }
+
+        lua_rawgeti(lua, LUA_REGISTRYINDEX, *ref);
+
+        if(lua_rawequal(lua, -1, -2))
+        {
+            lua_pop(lua, 2);
+            continue;
+        }
+
+        lua_pop(lua, 1);
+        luaL_unref(lua, LUA_REGISTRYINDEX, *ref);
+
+        if(lua_isnil(lua, -1))
+        {
+            lua_pop(lua, 1);
+            *ref = LUA_NOREF;
+        }
+        else *ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+
+        core->callbackResolves++;
+    }
+}
+
+static bool pushLuaCallback(tic_core* core, s32 index)
+{
+    if(!core->callbacks.lua)
+        resolveLuaCallbacks(core);
+
+    if(!core->callbacks.lua || core->callbacks.lua->refs[index] == LUA_NOREF)
+        return false;
+
+    lua_rawgeti(core->lua, LUA_REGISTRYINDEX, core->callbacks.lua->refs[index]);
+    return true;
+}
+
 static void callLuaTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -1375,44 +2349,48 @@ static void callLuaTick(tic_mem* tic)
 
     if(lua)
     {
-        lua_getglobal(lua, TIC_FN);
-        if(lua_isfunction(lua, -1)) 
+        if(pushLuaCallback(core, CallbackTick))
         {
             if(docall(lua, 0, 0) != LUA_OK) 
                 core->data->error(core->data->data, lua_tostring(lua, -1));
         }
-        else 
-        {       
-            lua_pop(lua, 1);
-            core->data->error(core->data->data, "'function TIC()...' isn't found :(");
-        }
+        else core->data->error(core->data->data, "'function TIC()...' isn't found :(");
+
+        resolveLuaCallbacks(core);
     }
 }
 
-static void callLuaScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void idleLua(tic_mem* tic, u64 deadline)
 {
     tic_core* core = (tic_core*)tic;
     lua_State* lua = core->lua;
+    tic_tick_data* data = core->data;
+
+    // incremental steps pay off the collector debt before the next TIC(),
+    // a finished cycle ends the slice as stepping on would start a new one
+    if(lua)
+        while(!lua_gc(lua, LUA_GCSTEP, 0) && data->counter(data->data) < deadline) {}
+}
 
-    if (lua)
+static void callLuaScanlineCallback(tic_mem* tic, s32 row, void* data, s32 index)
+{
+    tic_core* core = (tic_core*)tic;
+    lua_State* lua = core->lua;
+
+    if (lua && pushLuaCallback(core, index))
     {
-        lua_getglobal(lua, name);
-        if(lua_isfunction(lua, -1))
-        {
-            lua_pushinteger(lua, row);
-            if(docall(lua, 1, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else lua_pop(lua, 1);
+        lua_pushinteger(lua, row);
+        if(docall(lua, 1, 0) != LUA_OK)
+            core->data->error(core->data->data, lua_tostring(lua, -1));
     }
 }
 
 static void callLuaScanline(tic_mem* tic, s32 row, void* data)
 {
-    callLuaScanlineName(tic, row, data, SCN_FN);
+    callLuaScanlineCallback(tic, row, data, CallbackScanline);
 
     // try to call old scanline
-    callLuaScanlineName(tic, row, data, "scanline");
+    callLuaScanlineCallback(tic, row, data, CallbackLegacyScanline);
 }
 
 static void callLuaOverline(tic_mem* tic, void* data)
@@ -1420,19 +2398,11 @@ static void callLuaOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     lua_State* lua = core->lua;
 
-    if (lua)
+    if (lua && pushLuaCallback(core, CallbackOverline))
     {
-        const char* OvrFunc = OVR_FN;
-
-        lua_getglobal(lua, OvrFunc);
-        if(lua_isfunction(lua, -1)) 
-        {
-            if(docall(lua, 0, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else lua_pop(lua, 1);
+        if(docall(lua, 0, 0) != LUA_OK)
+            core->data->error(core->data->data, lua_tostring(lua, -1));
     }
-
 }
 
 static const char* const LuaKeywords [] =
@@ -1526,9 +2496,11 @@ static const tic_script_config LuaSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .idle               = idleLua,
 
     .getOutline         = getLuaOutline,
     .eval               = evalLua,
+    .compile            = compileLua,
 
     .blockCommentStart  = "--[[",
     .blockCommentEnd    = "]]",
@@ -1562,6 +2534,15 @@ static const char* execute_moonscript_src = MOON_CODE(
     return fn()
 );
 
+static const char* compile_moonscript_src = MOON_CODE(
+    local fn, err = require('moonscript.base').loadstring(...)
+
+    if not fn then
+        error(err)
+    end
+    return fn
+);
+
 static void setloaded(lua_State* l, char* name)
 {
     s32 top = lua_gettop(l);
@@ -1577,31 +2558,46 @@ static void setloaded(lua_State* l, char* name)
     lua_settop(l, top);
 }
 
-static bool initMoonscript(tic_mem* tic, const char* code)
+static bool loadMoonscript(lua_State* moon)
 {
-    tic_core* core = (tic_core*)tic;
-    closeLua(tic);
+    luaopen_lpeg(moon);
+    setloaded(moon, "lpeg");
 
-    lua_State* lua = core->lua = luaL_newstate();
-    lua_open_builtins(lua);
+    lua_settop(moon, 0);
 
-    luaopen_lpeg(lua);
-    setloaded(lua, "lpeg");
-
-    initAPI(core);
+    return luaL_loadbuffer(moon, (const char *)moonscript_lua, moonscript_lua_len, "moonscript.lua") == LUA_OK
+        && lua_pcall(moon, 0, 0, 0) == LUA_OK;
+}
 
+static bool preloadMoonscript(tic_core* core)
+{
+    if (!loadMoonscript(core->lua))
     {
-        lua_State* moon = core->lua;
+        core->data->error(core->data->data, "failed to load moonscript.lua");
+        return false;
+    }
 
-        lua_settop(moon, 0);
+    return true;
+}
 
-        if (luaL_loadbuffer(moon, (const char *)moonscript_lua, moonscript_lua_len, "moonscript.lua") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load moonscript.lua");
-            return false;
-        }
+static bool compileMoonscript(const char* code, tic_binary* binary)
+{
+    return compileTranspiled(code, binary, loadMoonscript, compile_moonscript_src, "compile_moonscript");
+}
+
+static bool initMoonscript(tic_mem* tic, const char* code)
+{
+    tic_core* core = (tic_core*)tic;
+
+    if (!warmLua(core, LuaVmMoonscript, preloadMoonscript))
+        return false;
+
+    bool done = false;
+    if (runLuaBinary(core, code, &done))
+        return done;
 
-        lua_call(moon, 0, 0);
+    {
+        lua_State* moon = core->lua;
 
         if (luaL_loadbuffer(moon, execute_moonscript_src, strlen(execute_moonscript_src), "execute_moonscript") != LUA_OK)
         {
@@ -1693,9 +2689,12 @@ static const tic_script_config MoonSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .idle               = idleLua,
 
     .getOutline         = getMoonOutline,
     .eval               = NULL,
+    .compile            = compileMoonscript,
+    .compiler           = "moonscript",
 
     .blockCommentStart  = NULL,
     .blockCommentEnd    = NULL,
@@ -1728,30 +2727,51 @@ static const char* execute_fennel_src = FENNEL_CODE(
   if(not ok) then return msg end
 );
 
+static const char* compile_fennel_src = FENNEL_CODE(
+  local opts = {filename="game", correlate=true, allowedGlobals=false}
+  local src = require('fennel').compileString(..., opts)
+  return load(src, "@game")
+);
+
+static bool loadFennel(lua_State* fennel)
+{
+    lua_settop(fennel, 0);
+
+    return luaL_loadbuffer(fennel, (const char *)loadfennel_lua,
+                           loadfennel_lua_len, "fennel.lua") == LUA_OK
+        && lua_pcall(fennel, 0, 0, 0) == LUA_OK;
+}
+
+static bool preloadFennel(tic_core* core)
+{
+    if (!loadFennel(core->lua))
+    {
+        core->data->error(core->data->data, "failed to load fennel compiler");
+        return false;
+    }
+
+    return true;
+}
+
+static bool compileFennel(const char* code, tic_binary* binary)
+{
+    return compileTranspiled(code, binary, loadFennel, compile_fennel_src, "compile_fennel");
+}
+
 static bool initFennel(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
-    closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
-    lua_open_builtins(lua);
+    if (!warmLua(core, LuaVmFennel, preloadFennel))
+        return false;
 
-    initAPI(core);
+    bool done = false;
+    if (runLuaBinary(core, code, &done))
+        return done;
 
     {
         lua_State* fennel = core->lua;
 
-        lua_settop(fennel, 0);
-
-        if (luaL_loadbuffer(fennel, (const char *)loadfennel_lua,
-                            loadfennel_lua_len, "fennel.lua") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load fennel compiler");
-            return false;
-        }
-
-        lua_call(fennel, 0, 0);
-
         if (luaL_loadbuffer(fennel, execute_fennel_src, strlen(execute_fennel_src), "execute_fennel") != LUA_OK)
         {
             core->data->error(core->data->data, "failed to load fennel compiler");
@@ -1869,9 +2889,12 @@ static const tic_script_config FennelSyntaxConfig =
     .tick               = callLuaTick,
     .scanline           = callLuaScanline,
     .overline           = callLuaOverline,
+    .idle               = idleLua,
 
     .getOutline         = getFennelOutline,
     .eval               = evalFennel,
+    .compile            = compileFennel,
+    .compiler           = "fennel",
 
     .blockCommentStart  = NULL,
     .blockCommentEnd    = NULL,
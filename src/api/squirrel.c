@@ -38,6 +38,24 @@
 
 static const char TicCore[] = "_TIC80";
 
+enum
+{
+    CallbackTick,
+    CallbackScanline,
+    CallbackLegacyScanline,
+    CallbackOverline,
+    CallbackCount
+};
+
+static const char* const CallbackNames[] = {TIC_FN, SCN_FN, "scanline", OVR_FN};
+
+// TIC/SCN/OVR are held as referenced handles, the root table
+// is looked up again once per frame after TIC()
+struct tic_squirrel_callbacks
+{
+    HSQOBJECT objects[CallbackCount];
+};
+
 
 // !TODO: get rid of this wrap
 static s32 getSquirrelNumber(HSQUIRRELVM vm, s32 index)
@@ -321,6 +339,52 @@ static SQInteger squirrel_circb(HSQUIRRELVM vm)
     return 0;
 }
 
+static SQInteger squirrel_elli(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 6)
+    {
+        s32 a = getSquirrelNumber(vm, 4);
+        s32 b = getSquirrelNumber(vm, 5);
+        if(a < 0 || b < 0) return 0;
+
+        s32 x = getSquirrelNumber(vm, 2);
+        s32 y = getSquirrelNumber(vm, 3);
+        s32 color = getSquirrelNumber(vm, 6);
+
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+        tic_api_elli(tic, x, y, a, b, color);
+    }
+    else return sq_throwerror(vm, "invalid parameters, elli(x,y,a,b,color)\n");
+
+    return 0;
+}
+
+static SQInteger squirrel_ellib(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 6)
+    {
+        s32 a = getSquirrelNumber(vm, 4);
+        s32 b = getSquirrelNumber(vm, 5);
+        if(a < 0 || b < 0) return 0;
+
+        s32 x = getSquirrelNumber(vm, 2);
+        s32 y = getSquirrelNumber(vm, 3);
+        s32 color = getSquirrelNumber(vm, 6);
+
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+        tic_api_ellib(tic, x, y, a, b, color);
+    }
+    else return sq_throwerror(vm, "invalid parameters, ellib(x,y,a,b,color)\n");
+
+    return 0;
+}
+
 static SQInteger squirrel_tri(HSQUIRRELVM vm)
 {
     SQInteger top = sq_gettop(vm);
@@ -396,6 +460,19 @@ static SQInteger squirrel_textri(HSQUIRRELVM vm)
             count = 1;
         }
 
+        //  check for perspective z
+        float z[3] = {0};
+        bool perspective = top >= 18;
+        if(perspective)
+        {
+            for (s32 i = 0; i < COUNT_OF(z); i++)
+            {
+                SQFloat f = 0.0;
+                sq_getfloat(vm, i + 16, &f);
+                z[i] = (float)f;
+            }
+        }
+
         tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                                     pt[2], pt[3],   //  xy 2
                                     pt[4], pt[5],   //  xy 3
@@ -403,9 +480,69 @@ static SQInteger squirrel_textri(HSQUIRRELVM vm)
                                     pt[8], pt[9],   //  uv 2
                                     pt[10], pt[11], //  uv 3
                                     use_map,        // use map
-                                    colors, count);        // chroma
+                                    colors, count,  // chroma
+                                    z[0], z[1], z[2], perspective);
     }
-    else return sq_throwerror(vm, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off])\n");
+    else return sq_throwerror(vm, "invalid parameters, textri(x1,y1,x2,y2,x3,y3,u1,v1,u2,v2,u3,v3,[use_map=false],[chroma=off],[z1,z2,z3])\n");
+    return 0;
+}
+
+static SQInteger squirrel_mesh(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top >= 5)
+    {
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+        static u8 colors[TIC_PALETTE_SIZE];
+        s32 count = 0;
+
+        s32 vertices = getSquirrelNumber(vm, 2);
+        s32 indices = getSquirrelNumber(vm, 3);
+        s32 triangles = getSquirrelNumber(vm, 4);
+        u8 color = getSquirrelNumber(vm, 5);
+        u8 flags = top >= 6 ? getSquirrelNumber(vm, 6) : 0;
+        s32 uvs = top >= 7 ? getSquirrelNumber(vm, 7) : -1;
+        bool use_map = false;
+
+        if(top >= 8)
+        {
+            SQBool b = SQFalse;
+            sq_getbool(vm, 8, &b);
+            use_map = (b != SQFalse);
+        }
+
+        if(top >= 9)
+        {
+            if(OT_ARRAY == sq_gettype(vm, 9))
+            {
+                for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+                {
+                    sq_pushinteger(vm, (SQInteger)i);
+                    sq_rawget(vm, 9);
+                    if(sq_gettype(vm, -1) & (OT_FLOAT|OT_INTEGER))
+                    {
+                        colors[i] = getSquirrelNumber(vm, -1);
+                        count++;
+                        sq_poptop(vm);
+                    }
+                    else
+                    {
+                        sq_poptop(vm);
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                colors[0] = getSquirrelNumber(vm, 9);
+                count = 1;
+            }
+        }
+
+        tic_api_mesh(tic, vertices, indices, triangles, color, flags, uvs, use_map, colors, count);
+    }
+    else return sq_throwerror(vm, "invalid parameters, mesh(vaddr,iaddr,count,color,[flags=0],[uvaddr=-1],[use_map=false],[chroma=off])\n");
     return 0;
 }
 
@@ -575,6 +712,46 @@ static SQInteger squirrel_spr(HSQUIRRELVM vm)
     return 0;
 }
 
+static SQInteger squirrel_sprs(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+    tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+    if(top >= 2 && (sq_gettype(vm, 2) == OT_STRING || sq_gettype(vm, 2) == OT_INSTANCE))
+    {
+        const SQChar* str = NULL;
+        SQUserPointer records = NULL;
+        SQInteger size = 0;
+
+        if(sq_gettype(vm, 2) == OT_STRING)
+        {
+            sq_getstringandsize(vm, 2, &str, &size);
+            records = (SQUserPointer)str;
+        }
+        else if(SQ_SUCCEEDED(sqstd_getblob(vm, 2, &records)))
+            size = sqstd_getblobsize(vm, 2);
+        else
+            return sq_throwerror(vm, "invalid parameters, sprs(buffer,[count])\n");
+
+        s32 count = top >= 3 ? getSquirrelNumber(vm, 3) : (s32)size / TIC_SPRITE_RECORD_SIZE;
+
+        tic_api_sprs(tic, records, (s32)size, count);
+        return 0;
+    }
+    else if(top == 3)
+    {
+        s32 address = getSquirrelNumber(vm, 2);
+        s32 count = getSquirrelNumber(vm, 3);
+
+        if(address >= 0 && address < sizeof(tic_ram))
+            tic_api_sprs(tic, (const u8*)&tic->ram + address, sizeof(tic_ram) - address, count);
+
+        return 0;
+    }
+
+    return sq_throwerror(vm, "invalid parameters, sprs(addr,count) or sprs(buffer,[count])\n");
+}
+
 static SQInteger squirrel_mget(HSQUIRRELVM vm)
 {
     SQInteger top = sq_gettop(vm);
@@ -798,6 +975,21 @@ static SQInteger squirrel_music(HSQUIRRELVM vm)
     return 0;
 }
 
+static SQInteger squirrel_mpos(HSQUIRRELVM vm)
+{
+    tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+    tic_music_pos pos = tic_api_mpos(tic);
+
+    sq_newarray(vm, 0);
+    sq_pushinteger(vm, pos.tick);
+    sq_arrayappend(vm, -2);
+    sq_pushinteger(vm, pos.duration);
+    sq_arrayappend(vm, -2);
+
+    return 1;
+}
+
 static SQInteger squirrel_sfx(HSQUIRRELVM vm)
 {
     SQInteger top = sq_gettop(vm);
@@ -1041,6 +1233,270 @@ static SQInteger squirrel_memset(HSQUIRRELVM vm)
     return sq_throwerror(vm, "invalid params, memset(dest,val,size)\n");
 }
 
+// peekbuf(addr,size) returns the bytes as a string
+static SQInteger squirrel_peekbuf(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 3)
+    {
+        s32 address = getSquirrelNumber(vm, 2);
+        s32 size = getSquirrelNumber(vm, 3);
+
+        u8* data = size >= 0 && size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+        if(data)
+        {
+            tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+            bool done = tic_api_peekbuf(tic, address, data, size);
+
+            if(done)
+                sq_pushstring(vm, (const SQChar*)data, size);
+
+            free(data);
+
+            if(done)
+                return 1;
+        }
+    }
+
+    return sq_throwerror(vm, "invalid params, peekbuf(addr,size)\n");
+}
+
+// pokebuf(addr,data) writes a string or an array of bytes
+static SQInteger squirrel_pokebuf(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 3)
+    {
+        s32 address = getSquirrelNumber(vm, 2);
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+        if(sq_gettype(vm, 3) == OT_STRING)
+        {
+            const SQChar* data = NULL;
+            SQInteger size = 0;
+            sq_getstringandsize(vm, 3, &data, &size);
+
+            if(size <= sizeof(tic_ram) && tic_api_pokebuf(tic, address, (const u8*)data, (s32)size))
+                return 0;
+        }
+        else if(sq_gettype(vm, 3) == OT_ARRAY)
+        {
+            SQInteger size = sq_getsize(vm, 3);
+            u8* data = size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+            if(data)
+            {
+                for(s32 i = 0; i < size; i++)
+                {
+                    sq_pushinteger(vm, i);
+                    sq_rawget(vm, 3);
+                    data[i] = getSquirrelNumber(vm, -1);
+                    sq_poptop(vm);
+                }
+
+                bool done = tic_api_pokebuf(tic, address, data, (s32)size);
+                free(data);
+
+                if(done)
+                    return 0;
+            }
+        }
+    }
+
+    return sq_throwerror(vm, "invalid params, pokebuf(addr,data)\n");
+}
+
+static SQInteger squirrel_memcpy4(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 4)
+    {
+        s32 dest = getSquirrelNumber(vm, 2);
+        s32 src = getSquirrelNumber(vm, 3);
+        s32 size = getSquirrelNumber(vm, 4);
+
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+        tic_api_memcpy4(tic, dest, src, size);
+        return 0;
+    }
+
+    return sq_throwerror(vm, "invalid params, memcpy4(dest,src,size)\n");
+}
+
+static SQInteger squirrel_memset4(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+
+    if(top == 4)
+    {
+        s32 dest = getSquirrelNumber(vm, 2);
+        u8 value = getSquirrelNumber(vm, 3);
+        s32 size = getSquirrelNumber(vm, 4);
+
+        tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+        tic_api_memset4(tic, dest, value, size);
+        return 0;
+    }
+
+    return sq_throwerror(vm, "invalid params, memset4(dest,val,size)\n");
+}
+
+// ram() views are userdata over the RAM range, indexed from 0, with a
+// shared delegate, the range is checked once when the view is made;
+// a blob always owns a copy of its data, so it can't be used here
+static const char RamView[] = "_TIC80_RAM_VIEW";
+
+typedef struct
+{
+    u8* data;
+    s32 size;
+} SquirrelRamView;
+
+static SquirrelRamView* getRamView(HSQUIRRELVM vm)
+{
+    SQUserPointer view = NULL, tag = NULL;
+
+    return SQ_SUCCEEDED(sq_getuserdata(vm, 1, &view, &tag)) && tag == RamView ? view : NULL;
+}
+
+static SQInteger squirrel_ram(HSQUIRRELVM vm)
+{
+    SQInteger top = sq_gettop(vm);
+    tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
+
+    s32 address = top >= 2 ? getSquirrelNumber(vm, 2) : 0;
+    s32 size = top >= 3 ? getSquirrelNumber(vm, 3) : (s32)sizeof(tic_ram) - address;
+
+    u8* data = tic_api_ram(tic, address, size);
+
+    if(!data)
+        return sq_throwerror(vm, "invalid parameters, ram([addr],[size])\n");
+
+    SquirrelRamView* view = sq_newuserdata(vm, sizeof(SquirrelRamView));
+    view->data = data;
+    view->size = size;
+    sq_settypetag(vm, -1, (SQUserPointer)RamView);
+
+    sq_pushregistrytable(vm);
+    sq_pushstring(vm, RamView, -1);
+    sq_get(vm, -2);
+    sq_remove(vm, -2);
+    sq_setdelegate(vm, -2);
+
+    return 1;
+}
+
+static SQInteger squirrel_ramview_get(HSQUIRRELVM vm)
+{
+    SquirrelRamView* view = getRamView(vm);
+    s32 index = getSquirrelNumber(vm, 2);
+
+    if(view && (sq_gettype(vm, 2) & (OT_INTEGER | OT_FLOAT)) && (u32)index < (u32)view->size)
+    {
+        sq_pushinteger(vm, view->data[index]);
+        return 1;
+    }
+
+    // a thrown null reports a missing slot
+    sq_pushnull(vm);
+    return sq_throwobject(vm);
+}
+
+static SQInteger squirrel_ramview_set(HSQUIRRELVM vm)
+{
+    SquirrelRamView* view = getRamView(vm);
+    s32 index = getSquirrelNumber(vm, 2);
+
+    if(view && (sq_gettype(vm, 2) & (OT_INTEGER | OT_FLOAT)) && (u32)index < (u32)view->size)
+    {
+        view->data[index] = getSquirrelNumber(vm, 3);
+        return 0;
+    }
+
+    return sq_throwerror(vm, "ram view index out of range\n");
+}
+
+static SQInteger squirrel_ramview_len(HSQUIRRELVM vm)
+{
+    SquirrelRamView* view = getRamView(vm);
+
+    sq_pushinteger(vm, view ? view->size : 0);
+    return 1;
+}
+
+// view.read([offset],[size]) returns the bytes as a string
+static SQInteger squirrel_ramview_read(HSQUIRRELVM vm)
+{
+    SquirrelRamView* view = getRamView(vm);
+    SQInteger top = sq_gettop(vm);
+
+    if(view)
+    {
+        s32 offset = top >= 2 ? getSquirrelNumber(vm, 2) : 0;
+        s32 size = top >= 3 ? getSquirrelNumber(vm, 3) : view->size - offset;
+
+        if(offset >= 0 && size >= 0 && offset <= view->size - size)
+        {
+            sq_pushstring(vm, (const SQChar*)view->data + offset, size);
+            return 1;
+        }
+    }
+
+    return sq_throwerror(vm, "invalid parameters, view.read([offset],[size])\n");
+}
+
+// view.write(offset,string) copies the string in
+static SQInteger squirrel_ramview_write(HSQUIRRELVM vm)
+{
+    SquirrelRamView* view = getRamView(vm);
+
+    const SQChar* data = NULL;
+    SQInteger size = 0;
+
+    if(view && sq_gettop(vm) == 3 && SQ_SUCCEEDED(sq_getstringandsize(vm, 3, &data, &size)))
+    {
+        s32 offset = getSquirrelNumber(vm, 2);
+
+        if(offset >= 0 && offset <= view->size && size <= view->size - offset)
+        {
+            memcpy(view->data + offset, data, size);
+            return 0;
+        }
+    }
+
+    return sq_throwerror(vm, "invalid parameters, view.write(offset,string)\n");
+}
+
+static void initRamView(HSQUIRRELVM vm)
+{
+    static const struct{SQFUNCTION func; const char* name;} Methods[] =
+    {
+        {squirrel_ramview_get, "_get"},
+        {squirrel_ramview_set, "_set"},
+        {squirrel_ramview_len, "len"},
+        {squirrel_ramview_read, "read"},
+        {squirrel_ramview_write, "write"},
+    };
+
+    sq_pushregistrytable(vm);
+    sq_pushstring(vm, RamView, -1);
+    sq_newtable(vm);
+
+    for (s32 i = 0; i < COUNT_OF(Methods); i++)
+    {
+        sq_pushstring(vm, Methods[i].name, -1);
+        sq_newclosure(vm, Methods[i].func, 0);
+        sq_newslot(vm, -3, SQFalse);
+    }
+
+    sq_newslot(vm, -3, SQFalse);
+    sq_poptop(vm);
+}
+
 // NB we leave the string on the stack so that the char* pointer remains valid.
 static const char* printString(HSQUIRRELVM vm, s32 index)
 {
@@ -1400,6 +1856,8 @@ static void initAPI(tic_core* core)
     registerSquirrelFunction(core, squirrel_dofile, "dofile");
     registerSquirrelFunction(core, squirrel_loadfile, "loadfile");
 
+    initRamView(vm);
+
 #if CHECK_FORCE_EXIT
     sq_setnativedebughook(vm, checkForceExit);
 #endif
@@ -1416,6 +1874,9 @@ static void closeSquirrel(tic_mem* tic)
         sq_close(core->squirrel);
         core->squirrel = NULL;
     }
+
+    free(core->callbacks.squirrel);
+    core->callbacks.squirrel = NULL;
 }
 
 static bool initSquirrel(tic_mem* tic, const char* code)
@@ -1458,77 +1919,121 @@ static bool initSquirrel(tic_mem* tic, const char* code)
     return true;
 }
 
-static void callSquirrelTick(tic_mem* tic)
+static void resolveSquirrelCallbacks(tic_core* core)
 {
-    tic_core* core = (tic_core*)tic;
-
     HSQUIRRELVM vm = core->squirrel;
+    struct tic_squirrel_callbacks* callbacks = core->callbacks.squirrel;
 
-    if(vm)
+    if(!callbacks)
+    {
+        callbacks = core->callbacks.squirrel = malloc(sizeof(struct tic_squirrel_callbacks));
+
+        if(!callbacks) return;
+
+        for(s32 i = 0; i < CallbackCount; i++)
+            sq_resetobject(&callbacks->objects[i]);
+    }
+
+    for(s32 i = 0; i < CallbackCount; i++)
     {
+        HSQOBJECT* cached = &callbacks->objects[i];
+        HSQOBJECT object;
+        sq_resetobject(&object);
+
         sq_pushroottable(vm);
-        sq_pushstring(vm, TIC_FN, -1);
+        sq_pushstring(vm, CallbackNames[i], -1);
 
-        if (SQ_SUCCEEDED(sq_get(vm, -2)))
+        if(SQ_SUCCEEDED(sq_get(vm, -2)))
         {
-            sq_pushroottable(vm);
-            if(SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3); // remove string, error and root table.
-            }
+            sq_getstackobj(vm, -1, &object);
+            sq_poptop(vm);
         }
-        else 
-        {       
-            sq_pop(vm, 1);
-            if (core->data)
-                core->data->error(core->data->data, "'function TIC()...' isn't found :(");
+
+        sq_poptop(vm);
+
+        if(object._type != cached->_type || object._unVal.raw != cached->_unVal.raw)
+        {
+            sq_release(vm, cached);
+            *cached = object;
+            sq_addref(vm, cached);
+
+            core->callbackResolves++;
         }
     }
 }
 
-static void callSquirrelScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static bool pushSquirrelCallback(tic_core* core, s32 index)
+{
+    if(!core->callbacks.squirrel)
+        resolveSquirrelCallbacks(core);
+
+    if(!core->callbacks.squirrel || sq_isnull(core->callbacks.squirrel->objects[index]))
+        return false;
+
+    sq_pushobject(core->squirrel, core->callbacks.squirrel->objects[index]);
+    return true;
+}
+
+static void callSquirrelCallback(tic_core* core, s32 params)
+{
+    HSQUIRRELVM vm = core->squirrel;
+
+    if(SQ_FAILED(sq_call(vm, params, SQFalse, SQTrue)))
+    {
+        sq_getlasterror(vm);
+        sq_tostring(vm, -1);
+
+        const SQChar* errorString = "unknown error";
+        sq_getstring(vm, -1, &errorString);
+
+        if (core->data)
+            core->data->error(core->data->data, errorString);
+
+        sq_pop(vm, 2); // error string and error
+    }
+
+    sq_poptop(vm); // the callback
+}
+
+static void callSquirrelTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
+
     HSQUIRRELVM vm = core->squirrel;
 
-    if (vm)
+    if(vm)
     {
-        sq_pushroottable(vm);
-        sq_pushstring(vm, name, -1);
-        if (SQ_SUCCEEDED(sq_get(vm, -2)))
+        if(pushSquirrelCallback(core, CallbackTick))
         {
             sq_pushroottable(vm);
-            sq_pushinteger(vm, row);
-
-            if(SQ_FAILED(sq_call(vm, 2, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3); // error string, error and root table
-            }
+            callSquirrelCallback(core, 1);
         }
-        else sq_poptop(vm);
+        else if (core->data)
+            core->data->error(core->data->data, "'function TIC()...' isn't found :(");
+
+        resolveSquirrelCallbacks(core);
+    }
+}
+
+static void callSquirrelScanlineCallback(tic_mem* tic, s32 row, void* data, s32 index)
+{
+    tic_core* core = (tic_core*)tic;
+    HSQUIRRELVM vm = core->squirrel;
+
+    if (vm && pushSquirrelCallback(core, index))
+    {
+        sq_pushroottable(vm);
+        sq_pushinteger(vm, row);
+        callSquirrelCallback(core, 2);
     }
 }
 
 static void callSquirrelScanline(tic_mem* tic, s32 row, void* data)
 {
-    callSquirrelScanlineName(tic, row, data, SCN_FN);
+    callSquirrelScanlineCallback(tic, row, data, CallbackScanline);
 
     // try to call old scanline
-    callSquirrelScanlineName(tic, row, data, "scanline");
+    callSquirrelScanlineCallback(tic, row, data, CallbackLegacyScanline);
 }
 
 static void callSquirrelOverline(tic_mem* tic, void* data)
@@ -1536,30 +2041,11 @@ static void callSquirrelOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     HSQUIRRELVM vm = core->squirrel;
 
-    if (vm)
+    if (vm && pushSquirrelCallback(core, CallbackOverline))
     {
-        const char* OvrFunc = OVR_FN;
-
         sq_pushroottable(vm);
-        sq_pushstring(vm, OvrFunc, -1);
-        
-        if(SQ_SUCCEEDED(sq_get(vm, -2))) 
-        {
-            sq_pushroottable(vm);
-            if(SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3);
-            }
-        }
-        else sq_poptop(vm);
+        callSquirrelCallback(core, 1);
     }
-
 }
 
 static const char* const SquirrelKeywords [] =
@@ -62,6 +62,8 @@ class TIC {\n\
     foreign static spr(id, x, y, alpha_color, scale, flip)\n\
     foreign static spr(id, x, y, alpha_color, scale, flip, rotate)\n\
     foreign static spr(id, x, y, alpha_color, scale, flip, rotate, cell_width, cell_height)\n\
+    foreign static sprs(buffer)\n\
+    foreign static sprs(buffer, count)\n\
     foreign static map(cell_x, cell_y)\n\
     foreign static map(cell_x, cell_y, cell_w, cell_h)\n\
     foreign static map(cell_x, cell_y, cell_w, cell_h, x, y)\n\
@@ -73,11 +75,19 @@ class TIC {\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3)\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map)\n\
     foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, alpha_color)\n\
+    foreign static textri(x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, alpha_color, z1, z2, z3)\n\
+    foreign static mesh(vaddr, iaddr, count, color)\n\
+    foreign static mesh(vaddr, iaddr, count, color, flags)\n\
+    foreign static mesh(vaddr, iaddr, count, color, flags, uvaddr)\n\
+    foreign static mesh(vaddr, iaddr, count, color, flags, uvaddr, use_map)\n\
+    foreign static mesh(vaddr, iaddr, count, color, flags, uvaddr, use_map, alpha_color)\n\
     foreign static pix(x, y)\n\
     foreign static pix(x, y, color)\n\
     foreign static line(x0, y0, x1, y1, color)\n\
     foreign static circ(x, y, radius, color)\n\
     foreign static circb(x, y, radius, color)\n\
+    foreign static elli(x, y, a, b, color)\n\
+    foreign static ellib(x, y, a, b, color)\n\
     foreign static rect(x, y, w, h, color)\n\
     foreign static rectb(x, y, w, h, color)\n\
     foreign static tri(x1, y1, x2, y2, x3, y3, color)\n\
@@ -91,6 +101,13 @@ class TIC {\n\
     foreign static poke4(addr, val)\n\
     foreign static memcpy(dst, src, size)\n\
     foreign static memset(dst, src, size)\n\
+    foreign static peekbuf(addr, size)\n\
+    foreign static pokebuf(addr, data)\n\
+    foreign static memcpy4(dst, src, size)\n\
+    foreign static memset4(dst, val, size)\n\
+    foreign static ram()\n\
+    foreign static ram(addr)\n\
+    foreign static ram(addr, size)\n\
     foreign static pmem(index)\n\
     foreign static pmem(index, val)\n\
     foreign static sfx(id)\n\
@@ -104,6 +121,7 @@ class TIC {\n\
     foreign static music(track, frame)\n\
     foreign static music(track, frame, loop)\n\
     foreign static music(track, frame, loop, sustain)\n\
+    foreign static mpos()\n\
     foreign static time()\n\
     foreign static tstamp()\n\
     foreign static sync()\n\
@@ -165,6 +183,13 @@ class TIC {\n\
     " TIC_FN "(){}\n\
     " SCN_FN "(row){}\n\
     " OVR_FN "(){}\n\
+}\n\
+foreign class RamView {\n\
+    foreign [index]\n\
+    foreign [index]=(value)\n\
+    foreign count\n\
+    foreign read(offset, size)\n\
+    foreign write(offset, bytes)\n\
 }\n";
 
 static inline void wrenError(WrenVM* vm, const char* msg)
@@ -619,6 +644,30 @@ static void wren_spr_internal(WrenVM* vm)
     tic_api_spr(tic, index, x, y, 1, 1, colors, count, scale, flip, rotate);
 }
 
+static void wren_sprs(WrenVM* vm)
+{
+    s32 top = wrenGetSlotCount(vm);
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+
+    if(isString(vm, 1))
+    {
+        s32 size = 0;
+        const char* records = wrenGetSlotBytes(vm, 1, &size);
+        s32 count = top > 2 ? getWrenNumber(vm, 2) : size / TIC_SPRITE_RECORD_SIZE;
+
+        tic_api_sprs(tic, (const u8*)records, size, count);
+    }
+    else if(top > 2)
+    {
+        s32 address = getWrenNumber(vm, 1);
+        s32 count = getWrenNumber(vm, 2);
+
+        if(address >= 0 && address < sizeof(tic_ram))
+            tic_api_sprs(tic, (const u8*)&tic->ram + address, sizeof(tic_ram) - address, count);
+    }
+    else wrenError(vm, "invalid params, sprs(addr,count) or sprs(buffer,[count])\n");
+}
+
 static void wren_map(WrenVM* vm)
 {
     s32 x = 0;
@@ -757,6 +806,13 @@ static void wren_textri(WrenVM* vm)
         count = 1;
     }
 
+    //  check for perspective z
+    float z[3] = {0};
+    bool perspective = top > 17;
+    if(perspective)
+        for (s32 i = 0; i < COUNT_OF(z); i++)
+            z[i] = (float)wrenGetSlotDouble(vm, i + 15);
+
     tic_api_textri(tic, pt[0], pt[1],   //  xy 1
                                 pt[2], pt[3],   //  xy 2
                                 pt[4], pt[5],   //  xy 3
@@ -764,7 +820,54 @@ static void wren_textri(WrenVM* vm)
                                 pt[8], pt[9],   //  uv 2
                                 pt[10], pt[11], //  uv 3
                                 use_map,        // use map
-                                colors, count);        // chroma
+                                colors, count,  // chroma
+                                z[0], z[1], z[2], perspective);
+}
+
+static void wren_mesh(WrenVM* vm)
+{
+    int top = wrenGetSlotCount(vm);
+
+    s32 vertices = getWrenNumber(vm, 1);
+    s32 indices = getWrenNumber(vm, 2);
+    s32 triangles = getWrenNumber(vm, 3);
+    u8 color = getWrenNumber(vm, 4);
+    u8 flags = top > 5 ? getWrenNumber(vm, 5) : 0;
+    s32 uvs = top > 6 ? getWrenNumber(vm, 6) : -1;
+    bool use_map = top > 7 ? wrenGetSlotBool(vm, 7) : false;
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    static u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
+
+    if(top > 8)
+    {
+        if(isList(vm, 8))
+        {
+            wrenEnsureSlots(vm, top+1);
+            int list_count = wrenGetListCount(vm, 8);
+            for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+            {
+                wrenGetListElement(vm, 8, i, top);
+                if(i < list_count && isNumber(vm, top))
+                {
+                    colors[i] = getWrenNumber(vm, top);
+                    count++;
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+        else
+        {
+            colors[0] = getWrenNumber(vm, 8);
+            count = 1;
+        }
+    }
+
+    tic_api_mesh(tic, vertices, indices, triangles, color, flags, uvs, use_map, colors, count);
 }
 
 static void wren_pix(WrenVM* vm)
@@ -834,6 +937,42 @@ static void wren_circb(WrenVM* vm)
     tic_api_circb(tic, x, y, radius, color);
 }
 
+static void wren_elli(WrenVM* vm)
+{
+    s32 a = getWrenNumber(vm, 3);
+    s32 b = getWrenNumber(vm, 4);
+    if(a < 0 || b < 0)
+    {
+        return;
+    }
+
+    s32 x = getWrenNumber(vm, 1);
+    s32 y = getWrenNumber(vm, 2);
+    s32 color = getWrenNumber(vm, 5);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+
+    tic_api_elli(tic, x, y, a, b, color);
+}
+
+static void wren_ellib(WrenVM* vm)
+{
+    s32 a = getWrenNumber(vm, 3);
+    s32 b = getWrenNumber(vm, 4);
+    if(a < 0 || b < 0)
+    {
+        return;
+    }
+
+    s32 x = getWrenNumber(vm, 1);
+    s32 y = getWrenNumber(vm, 2);
+    s32 color = getWrenNumber(vm, 5);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+
+    tic_api_ellib(tic, x, y, a, b, color);
+}
+
 static void wren_rect(WrenVM* vm)
 {
     s32 x = getWrenNumber(vm, 1);
@@ -964,6 +1103,170 @@ static void wren_memset(WrenVM* vm)
     tic_api_memset(tic, dest, value, size);
 }
 
+// TIC.peekbuf(addr,size) returns the bytes as a string
+static void wren_peekbuf(WrenVM* vm)
+{
+    s32 address = getWrenNumber(vm, 1);
+    s32 size = getWrenNumber(vm, 2);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    u8* data = size >= 0 && size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+    if(data && tic_api_peekbuf(tic, address, data, size))
+        wrenSetSlotBytes(vm, 0, (const char*)data, size);
+    else wrenError(vm, "invalid params, peekbuf(addr,size)\n");
+
+    free(data);
+}
+
+// TIC.pokebuf(addr,data) writes a string or a list of bytes
+static void wren_pokebuf(WrenVM* vm)
+{
+    s32 address = getWrenNumber(vm, 1);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    bool done = false;
+
+    if(isString(vm, 2))
+    {
+        s32 size = 0;
+        const char* data = wrenGetSlotBytes(vm, 2, &size);
+
+        done = tic_api_pokebuf(tic, address, (const u8*)data, size);
+    }
+    else if(isList(vm, 2))
+    {
+        s32 size = wrenGetListCount(vm, 2);
+        u8* data = size <= sizeof(tic_ram) ? malloc(size + 1) : NULL;
+
+        if(data)
+        {
+            wrenEnsureSlots(vm, 4);
+
+            for(s32 i = 0; i < size; i++)
+            {
+                wrenGetListElement(vm, 2, i, 3);
+                data[i] = getWrenNumber(vm, 3);
+            }
+
+            done = tic_api_pokebuf(tic, address, data, size);
+            free(data);
+        }
+    }
+
+    if(!done)
+        wrenError(vm, "invalid params, pokebuf(addr,data)\n");
+}
+
+static void wren_memcpy4(WrenVM* vm)
+{
+    s32 dest = getWrenNumber(vm, 1);
+    s32 src = getWrenNumber(vm, 2);
+    s32 size = getWrenNumber(vm, 3);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    tic_api_memcpy4(tic, dest, src, size);
+}
+
+static void wren_memset4(WrenVM* vm)
+{
+    s32 dest = getWrenNumber(vm, 1);
+    u8 value = getWrenNumber(vm, 2);
+    s32 size = getWrenNumber(vm, 3);
+
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+    tic_api_memset4(tic, dest, value, size);
+}
+
+// TIC.ram() views are RamView instances over the RAM range, indexed from 0,
+// the range is checked once when the view is made
+typedef struct
+{
+    u8* data;
+    s32 size;
+} WrenRamView;
+
+static void wren_ram(WrenVM* vm)
+{
+    s32 top = wrenGetSlotCount(vm);
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+
+    s32 address = top > 1 ? getWrenNumber(vm, 1) : 0;
+    s32 size = top > 2 ? getWrenNumber(vm, 2) : (s32)sizeof(tic_ram) - address;
+
+    u8* data = tic_api_ram(tic, address, size);
+
+    if(data)
+    {
+        wrenEnsureSlots(vm, top + 1);
+        wrenGetVariable(vm, "main", "RamView", top);
+
+        WrenRamView* view = wrenSetSlotNewForeign(vm, 0, top, sizeof(WrenRamView));
+        view->data = data;
+        view->size = size;
+    }
+    else wrenError(vm, "invalid params, ram([addr],[size])\n");
+}
+
+static void wren_ramview_get(WrenVM* vm)
+{
+    WrenRamView* view = wrenGetSlotForeign(vm, 0);
+    s32 index = getWrenNumber(vm, 1);
+
+    if(isNumber(vm, 1) && (u32)index < (u32)view->size)
+        wrenSetSlotDouble(vm, 0, view->data[index]);
+    else wrenError(vm, "ram view index out of range\n");
+}
+
+static void wren_ramview_set(WrenVM* vm)
+{
+    WrenRamView* view = wrenGetSlotForeign(vm, 0);
+    s32 index = getWrenNumber(vm, 1);
+
+    if(isNumber(vm, 1) && (u32)index < (u32)view->size)
+        view->data[index] = getWrenNumber(vm, 2);
+    else wrenError(vm, "ram view index out of range\n");
+}
+
+static void wren_ramview_count(WrenVM* vm)
+{
+    WrenRamView* view = wrenGetSlotForeign(vm, 0);
+    wrenSetSlotDouble(vm, 0, view->size);
+}
+
+// view.read(offset,size) returns the bytes as a string
+static void wren_ramview_read(WrenVM* vm)
+{
+    WrenRamView* view = wrenGetSlotForeign(vm, 0);
+    s32 offset = getWrenNumber(vm, 1);
+    s32 size = getWrenNumber(vm, 2);
+
+    if(offset >= 0 && size >= 0 && offset <= view->size - size)
+        wrenSetSlotBytes(vm, 0, (const char*)view->data + offset, size);
+    else wrenError(vm, "invalid params, view.read(offset,size)\n");
+}
+
+// view.write(offset,bytes) copies the string in
+static void wren_ramview_write(WrenVM* vm)
+{
+    WrenRamView* view = wrenGetSlotForeign(vm, 0);
+    s32 offset = getWrenNumber(vm, 1);
+
+    if(isString(vm, 2))
+    {
+        s32 size = 0;
+        const char* data = wrenGetSlotBytes(vm, 2, &size);
+
+        if(offset >= 0 && offset <= view->size - size)
+        {
+            memcpy(view->data + offset, data, size);
+            return;
+        }
+    }
+
+    wrenError(vm, "invalid params, view.write(offset,bytes)\n");
+}
+
 static void wren_pmem(WrenVM* vm)
 {
     s32 top = wrenGetSlotCount(vm);
@@ -1110,6 +1413,21 @@ static void wren_music(WrenVM* vm)
     tic_api_music(tic, track, frame, row, loop, sustain);
 }
 
+static void wren_mpos(WrenVM* vm)
+{
+    tic_mem* tic = (tic_mem*)getWrenCore(vm);
+
+    tic_music_pos pos = tic_api_mpos(tic);
+
+    wrenEnsureSlots(vm, 2);
+    wrenSetSlotNewList(vm, 0);
+
+    wrenSetSlotDouble(vm, 1, pos.tick);
+    wrenInsertInList(vm, 0, 0, 1);
+    wrenSetSlotDouble(vm, 1, pos.duration);
+    wrenInsertInList(vm, 0, 1, 1);
+}
+
 static void wren_time(WrenVM* vm)
 {
     tic_mem* tic = (tic_mem*)getWrenCore(vm);
@@ -1236,6 +1554,8 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
     if (strcmp(signature, "static TIC.spr(_,_,_,_,_,_)"         ) == 0) return wren_spr;
     if (strcmp(signature, "static TIC.spr(_,_,_,_,_,_,_)"       ) == 0) return wren_spr;
     if (strcmp(signature, "static TIC.spr(_,_,_,_,_,_,_,_,_)"   ) == 0) return wren_spr;
+    if (strcmp(signature, "static TIC.sprs(_)"                  ) == 0) return wren_sprs;
+    if (strcmp(signature, "static TIC.sprs(_,_)"                ) == 0) return wren_sprs;
 
     if (strcmp(signature, "static TIC.map(_,_)"                 ) == 0) return wren_map;
     if (strcmp(signature, "static TIC.map(_,_,_,_)"             ) == 0) return wren_map;
@@ -1250,12 +1570,21 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
     if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_)"       ) == 0) return wren_textri;
     if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_,_)"     ) == 0) return wren_textri;
     if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_,_,_)"   ) == 0) return wren_textri;
+    if (strcmp(signature, "static TIC.textri(_,_,_,_,_,_,_,_,_,_,_,_,_,_,_,_,_)") == 0) return wren_textri;
+
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_)"            ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_)"          ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_,_)"        ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_,_,_)"      ) == 0) return wren_mesh;
+    if (strcmp(signature, "static TIC.mesh(_,_,_,_,_,_,_,_)"    ) == 0) return wren_mesh;
 
     if (strcmp(signature, "static TIC.pix(_,_)"                 ) == 0) return wren_pix;
     if (strcmp(signature, "static TIC.pix(_,_,_)"               ) == 0) return wren_pix;
     if (strcmp(signature, "static TIC.line(_,_,_,_,_)"          ) == 0) return wren_line;
     if (strcmp(signature, "static TIC.circ(_,_,_,_)"            ) == 0) return wren_circ;
     if (strcmp(signature, "static TIC.circb(_,_,_,_)"           ) == 0) return wren_circb;
+    if (strcmp(signature, "static TIC.elli(_,_,_,_,_)"          ) == 0) return wren_elli;
+    if (strcmp(signature, "static TIC.ellib(_,_,_,_,_)"         ) == 0) return wren_ellib;
     if (strcmp(signature, "static TIC.rect(_,_,_,_,_)"          ) == 0) return wren_rect;
     if (strcmp(signature, "static TIC.rectb(_,_,_,_,_)"         ) == 0) return wren_rectb;
     if (strcmp(signature, "static TIC.tri(_,_,_,_,_,_,_)"       ) == 0) return wren_tri;
@@ -1271,6 +1600,19 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
     if (strcmp(signature, "static TIC.poke4(_,_)"               ) == 0) return wren_poke4;
     if (strcmp(signature, "static TIC.memcpy(_,_,_)"            ) == 0) return wren_memcpy;
     if (strcmp(signature, "static TIC.memset(_,_,_)"            ) == 0) return wren_memset;
+    if (strcmp(signature, "static TIC.peekbuf(_,_)"             ) == 0) return wren_peekbuf;
+    if (strcmp(signature, "static TIC.pokebuf(_,_)"             ) == 0) return wren_pokebuf;
+    if (strcmp(signature, "static TIC.memcpy4(_,_,_)"           ) == 0) return wren_memcpy4;
+    if (strcmp(signature, "static TIC.memset4(_,_,_)"           ) == 0) return wren_memset4;
+    if (strcmp(signature, "static TIC.ram()"                    ) == 0) return wren_ram;
+    if (strcmp(signature, "static TIC.ram(_)"                   ) == 0) return wren_ram;
+    if (strcmp(signature, "static TIC.ram(_,_)"                 ) == 0) return wren_ram;
+
+    if (strcmp(signature, "RamView.[_]"                         ) == 0) return wren_ramview_get;
+    if (strcmp(signature, "RamView.[_]=(_)"                     ) == 0) return wren_ramview_set;
+    if (strcmp(signature, "RamView.count"                       ) == 0) return wren_ramview_count;
+    if (strcmp(signature, "RamView.read(_,_)"                   ) == 0) return wren_ramview_read;
+    if (strcmp(signature, "RamView.write(_,_)"                  ) == 0) return wren_ramview_write;
     if (strcmp(signature, "static TIC.pmem(_)"                  ) == 0) return wren_pmem;
     if (strcmp(signature, "static TIC.pmem(_,_)"                ) == 0) return wren_pmem;
 
@@ -1285,6 +1627,7 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
     if (strcmp(signature, "static TIC.music(_,_)"               ) == 0) return wren_music;
     if (strcmp(signature, "static TIC.music(_,_,_)"             ) == 0) return wren_music;
     if (strcmp(signature, "static TIC.music(_,_,_,_)"           ) == 0) return wren_music;
+    if (strcmp(signature, "static TIC.mpos()"                   ) == 0) return wren_mpos;
 
     if (strcmp(signature, "static TIC.time()"                   ) == 0) return wren_time;
     if (strcmp(signature, "static TIC.tstamp()"                 ) == 0) return wren_tstamp;
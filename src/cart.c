@@ -44,6 +44,7 @@ typedef enum
     CHUNK_MUSIC,        // 14
     CHUNK_PATTERNS,     // 15
     CHUNK_CODE_ZIP,     // 16
+    CHUNK_BINARY,       // 17
 } ChunkType;
 
 typedef struct
@@ -90,6 +91,16 @@ void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
         case CHUNK_CODE_ZIP:
             tic_tool_unzip(cart->code.data, TIC_CODE_SIZE, buffer, chunk.size);
             break;
+        case CHUNK_BINARY:
+            {
+                // the binary is split in TIC_BINARY_BANK_SIZE parts, one per bank
+                s32 offset = chunk.bank * TIC_BINARY_BANK_SIZE;
+                s32 size = MIN(TIC_BINARY_BANK_SIZE, chunk.size);
+
+                memcpy(cart->binary.data + offset, buffer, size);
+                cart->binary.size = MAX(cart->binary.size, offset + size);
+            }
+            break;
         case CHUNK_COVER:
             LOAD_CHUNK(cart->cover.data);
             cart->cover.size = chunk.size;
@@ -223,6 +234,15 @@ s32 tic_cart_save(const tic_cartridge* cart, u8* buffer)
             return 0;
     }
 
+    for(s32 i = 0; i < TIC_BANKS; i++)
+    {
+        s32 offset = i * TIC_BINARY_BANK_SIZE;
+
+        if(offset < cart->binary.size)
+            buffer = saveFixedChunk(buffer, CHUNK_BINARY, cart->binary.data + offset,
+                MIN(TIC_BINARY_BANK_SIZE, cart->binary.size - offset), i);
+    }
+
     buffer = saveFixedChunk(buffer, CHUNK_COVER, cart->cover.data, cart->cover.size, 0);
 
     #undef SAVE_CHUNK
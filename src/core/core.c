@@ -79,8 +79,21 @@ static void drawHLineOvr(tic_mem* tic, s32 x1, s32 x2, s32 y, u8 color)
     }
 }
 
+static void drawVLineOvr(tic_mem* tic, s32 x, s32 y1, s32 y2, u8 color)
+{
+    tic_core* core = (tic_core*)tic;
+    u32 final_color = *(core->state.ovr.raw + color);
+    if (y1 >= y2) return;
+    u32* dst = getOvrAddr(tic, x, y1);
+    for (s32 y = y1; y < y2; ++y, dst += TIC80_FULLWIDTH) {
+        *dst = final_color;
+    }
+}
+
 u8 tic_api_peek(tic_mem* memory, s32 address)
 {
+    FLUSH_DEFERRED(memory, address, 1);
+
     if (address >= 0 && address < sizeof(tic_ram))
         return *((u8*)&memory->ram + address);
 
@@ -89,12 +102,16 @@ u8 tic_api_peek(tic_mem* memory, s32 address)
 
 void tic_api_poke(tic_mem* memory, s32 address, u8 value)
 {
+    FLUSH_DEFERRED(memory, address, 1);
+
     if (address >= 0 && address < sizeof(tic_ram))
         *((u8*)&memory->ram + address) = value;
 }
 
 u8 tic_api_peek4(tic_mem* memory, s32 address)
 {
+    FLUSH_DEFERRED(memory, address >> 1, 1);
+
     if (address >= 0 && address < sizeof(tic_ram) * 2)
         return tic_tool_peek4((u8*)&memory->ram, address);
 
@@ -103,6 +120,8 @@ u8 tic_api_peek4(tic_mem* memory, s32 address)
 
 void tic_api_poke4(tic_mem* memory, s32 address, u8 value)
 {
+    FLUSH_DEFERRED(memory, address >> 1, 1);
+
     if (address >= 0 && address < sizeof(tic_ram) * 2)
         tic_tool_poke4((u8*)&memory->ram, address, value);
 }
@@ -118,6 +137,9 @@ void tic_api_memcpy(tic_mem* memory, s32 dst, s32 src, s32 size)
         && dst <= bound
         && src <= bound)
     {
+        FLUSH_DEFERRED(memory, dst, size);
+        FLUSH_DEFERRED(memory, src, size);
+
         u8* base = (u8*)&memory->ram;
         memcpy(base + dst, base + src, size);
     }
@@ -132,11 +154,124 @@ void tic_api_memset(tic_mem* memory, s32 dst, u8 val, s32 size)
         && dst >= 0
         && dst <= bound)
     {
+        FLUSH_DEFERRED(memory, dst, size);
+
         u8* base = (u8*)&memory->ram;
         memset(base + dst, val, size);
     }
 }
 
+static inline bool isRamRange(s32 address, s32 size, s32 limit)
+{
+    return size >= 0 && size <= limit && address >= 0 && address <= limit - size;
+}
+
+// bytes covered by size nibbles from the nibble address
+#define NIBBLE_BYTES(address, size) ((((address) + (size) + 1) >> 1) - ((address) >> 1))
+
+bool tic_api_peekbuf(tic_mem* memory, s32 address, u8* data, s32 size)
+{
+    if (!isRamRange(address, size, sizeof(tic_ram)))
+        return false;
+
+    FLUSH_DEFERRED(memory, address, size);
+
+    memcpy(data, (u8*)&memory->ram + address, size);
+    return true;
+}
+
+bool tic_api_pokebuf(tic_mem* memory, s32 address, const u8* data, s32 size)
+{
+    if (!isRamRange(address, size, sizeof(tic_ram)))
+        return false;
+
+    FLUSH_DEFERRED(memory, address, size);
+
+    memcpy((u8*)&memory->ram + address, data, size);
+    return true;
+}
+
+void tic_api_memcpy4(tic_mem* memory, s32 dst, s32 src, s32 size)
+{
+    s32 limit = sizeof(tic_ram) * 2;
+
+    if (size == 0 || !isRamRange(dst, size, limit) || !isRamRange(src, size, limit))
+        return;
+
+    FLUSH_DEFERRED(memory, dst >> 1, NIBBLE_BYTES(dst, size));
+    FLUSH_DEFERRED(memory, src >> 1, NIBBLE_BYTES(src, size));
+
+    u8* base = (u8*)&memory->ram;
+
+    if ((dst ^ src) & 1)
+    {
+        // the nibbles swap halves, copy them one by one in memmove order
+        if (dst < src)
+            for (s32 i = 0; i < size; i++)
+                tic_tool_poke4(base, dst + i, tic_tool_peek4(base, src + i));
+        else
+            for (s32 i = size - 1; i >= 0; i--)
+                tic_tool_poke4(base, dst + i, tic_tool_peek4(base, src + i));
+    }
+    else
+    {
+        // whole bytes are moved, the odd nibbles at the ends are read
+        // before anything is written since the ranges can overlap
+        s32 head = dst & 1;
+        s32 tail = (size - head) & 1;
+        u8 first = tic_tool_peek4(base, src);
+        u8 last = tic_tool_peek4(base, src + size - 1);
+
+        memmove(base + ((dst + head) >> 1), base + ((src + head) >> 1), (size - head) >> 1);
+
+        if (head) tic_tool_poke4(base, dst, first);
+        if (tail) tic_tool_poke4(base, dst + size - 1, last);
+    }
+}
+
+void tic_api_memset4(tic_mem* memory, s32 dst, u8 val, s32 size)
+{
+    if (size == 0 || !isRamRange(dst, size, sizeof(tic_ram) * 2))
+        return;
+
+    FLUSH_DEFERRED(memory, dst >> 1, NIBBLE_BYTES(dst, size));
+
+    u8* base = (u8*)&memory->ram;
+    val &= 0xf;
+
+    if (dst & 1)
+    {
+        tic_tool_poke4(base, dst++, val);
+        size--;
+    }
+
+    memset(base + (dst >> 1), val | val << 4, size >> 1);
+
+    if (size & 1)
+        tic_tool_poke4(base, dst + size - 1, val);
+}
+
+u8* tic_api_ram(tic_mem* memory, s32 address, s32 size)
+{
+    s32 bound = sizeof(tic_ram) - size;
+
+    if (size >= 0
+        && size <= sizeof(tic_ram)
+        && address >= 0
+        && address <= bound)
+    {
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+        // writes through the view can't be tracked, recorded draw calls
+        // could read the sheets, the map or vertex data behind it
+        tic_deferred_direct(memory, true);
+#endif
+
+        return (u8*)&memory->ram + address;
+    }
+
+    return NULL;
+}
+
 void tic_api_trace(tic_mem* memory, const char* text, u8 color)
 {
     tic_core* core = (tic_core*)memory;
@@ -188,6 +323,8 @@ void tic_api_sync(tic_mem* tic, u32 mask, s32 bank, bool toCart)
 
     mask &= ~core->state.synced & Mask;
 
+    FLUSH_DEFERRED(tic, 0, sizeof(tic_ram));
+
     assert(bank >= 0 && bank < TIC_BANKS);
 
     for (s32 i = 0; i < Count; i++)
@@ -245,6 +382,29 @@ static void drawHLineDma(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color)
     }
 }
 
+static void drawVLineDma(tic_mem* memory, s32 x, s32 yt, s32 yb, u8 color)
+{
+    if (yt >= yb) return;
+
+    // every row keeps the pixel in the same nibble, step a whole row of bytes
+    enum { Stride = TIC80_WIDTH >> 1 };
+    u8* screen = memory->ram.vram.screen.data + ((yt * TIC80_WIDTH + x) >> 1);
+
+    color &= 0x0f;
+
+    if (x & 1)
+    {
+        color <<= 4;
+        for (s32 y = yt; y < yb; y++, screen += Stride)
+            *screen = (*screen & 0x0f) | color;
+    }
+    else
+    {
+        for (s32 y = yt; y < yb; y++, screen += Stride)
+            *screen = (*screen & 0xf0) | color;
+    }
+}
+
 static void resetPalette(tic_mem* memory)
 {
     static const u8 DefaultMapping[] = { 16, 50, 84, 118, 152, 186, 220, 254 };
@@ -358,6 +518,65 @@ const tic_script_config* tic_core_script_config(tic_mem* memory)
 #endif
 }
 
+u32 tic_core_callback_resolves(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    return core->callbackResolves;
+}
+
+bool tic_core_compile(tic_mem* memory)
+{
+    const tic_script_config* config = tic_core_script_config(memory);
+    tic_binary* binary = &memory->cart.binary;
+
+    binary->size = 0;
+    binary->trusted = config->compile && config->compile(memory->cart.code.data, binary);
+
+    return binary->trusted;
+}
+
+static void updateTickStats(tic_core* core, u64 elapsed)
+{
+    tic_tick_data* data = core->data;
+    tic_tick_stats* stats = &core->timing.stats;
+
+    u64 freq = data->freq(data->data);
+    u64 average = core->timing.average;
+
+    if (stats->ticks && elapsed > average * 2 && elapsed > freq / 1000)
+        stats->spikes++;
+
+    core->timing.average = stats->ticks ? (average * 15 + elapsed) / 16 : elapsed;
+
+    u32 us = (u32)(elapsed * 1000000 / freq);
+    if (us > stats->worst)
+        stats->worst = us;
+
+    stats->ticks++;
+}
+
+void tic_core_idle(tic_mem* memory, s32 budget)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_tick_data* data = core->data;
+
+    if (budget <= 0 || !data || !core->state.initialized || !core->state.idle)
+        return;
+
+    u64 freq = data->freq(data->data);
+    u64 start = data->counter(data->data);
+
+    core->state.idle(memory, start + freq * budget / 1000000);
+
+    core->timing.stats.idle += (data->counter(data->data) - start) * 1000000 / freq;
+}
+
+tic_tick_stats tic_core_tick_stats(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    return core->timing.stats;
+}
+
 static void updateSaveid(tic_mem* memory)
 {
     memset(memory->saveid, 0, sizeof memory->saveid);
@@ -402,13 +621,21 @@ static void soundClear(tic_mem* memory)
 static void resetDma(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    tic_deferred_end(memory);
+#endif
+
     core->state.setpix = setPixelDma;
     core->state.getpix = getPixelDma;
     core->state.drawhline = drawHLineDma;
+    core->state.drawvline = drawVLineDma;
 }
 
 void tic_api_reset(tic_mem* memory)
 {
+    FLUSH_DEFERRED(memory, 0, sizeof(tic_ram));
+
     resetPalette(memory);
     resetBlitSegment(memory);
 
@@ -423,6 +650,8 @@ void tic_api_reset(tic_mem* memory)
     core->state.scanline = NULL;
     core->state.ovr.callback = NULL;
 
+    memset(core->depth, 0x7f, sizeof core->depth);
+
     resetDma(memory);
 
     updateSaveid(memory);
@@ -499,6 +728,10 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 
             data->start = data->counter(core->data->data);
 
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+            tic_deferred_direct(tic, false);
+#endif
+
             done = config->init(tic, code);
         }
         else
@@ -511,6 +744,10 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
             core->state.tick = config->tick;
             core->state.scanline = config->scanline;
             core->state.ovr.callback = config->overline;
+            core->state.idle = config->idle;
+
+            memset(&core->timing, 0, sizeof core->timing);
+            core->callbackResolves = 0;
 
             core->state.initialized = true;
         }
@@ -528,13 +765,27 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
             ZEROMEM(tic->ram.input.mouse);
     }
 
+    u64 start = data->counter(data->data);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    tic_deferred_begin(tic);
+#endif
+
     core->state.tick(tic);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    tic_deferred_end(tic);
+#endif
+
+    updateTickStats(core, data->counter(data->data) - start);
 }
 
 void tic_core_pause(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
 
+    SYNC_SYNTH(core);
+
     memcpy(&core->pause.state, &core->state, sizeof(tic_core_state_data));
     memcpy(&core->pause.ram, &memory->ram, sizeof(tic_ram));
     core->pause.input = memory->input.data;
@@ -553,6 +804,8 @@ void tic_core_resume(tic_mem* memory)
 
     if (core->data)
     {
+        SYNC_SYNTH(core);
+
         memcpy(&core->state, &core->pause.state, sizeof(tic_core_state_data));
         memcpy(&memory->ram, &core->pause.ram, sizeof(tic_ram));
         memory->input.data = core->pause.input;
@@ -592,9 +845,20 @@ void tic_core_close(tic_mem* memory)
     getWrenScriptConfig()->close(memory);
 #endif
 
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    if (core->deferred)
+        tic_deferred_close(core->deferred);
+#endif
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+    if (core->synth)
+        tic_synth_close(core->synth);
+#endif
+
     blip_delete(core->blip.left);
     blip_delete(core->blip.right);
 
+    free(core->seek);
     free(memory->samples.buffer);
     free(core);
 }
@@ -622,6 +886,21 @@ void tic_core_tick_end(tic_mem* memory)
     core->state.setpix = setPixelOvr;
     core->state.getpix = getPixelOvr;
     core->state.drawhline = drawHLineOvr;
+    core->state.drawvline = drawVLineOvr;
+}
+
+void tic_core_offline(tic_mem* memory)
+{
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+    tic_core* core = (tic_core*)memory;
+
+    // rendered sound must not lag a frame behind the ticks
+    if (core->synth)
+    {
+        tic_synth_close(core->synth);
+        core->synth = NULL;
+    }
+#endif
 }
 
 // copied from SDL2
@@ -745,6 +1024,8 @@ tic_mem* tic_core_create(s32 samplerate)
         return NULL;
     }
 
+    tic_tilesheet_init();
+
     core->memory.screen_format = TIC80_PIXEL_COLOR_RGBA8888;
     core->samplerate = samplerate;
 #ifdef _3DS
@@ -754,7 +1035,7 @@ tic_mem* tic_core_create(s32 samplerate)
     core->memory.screen = linearAlloc(TIC80_FULLWIDTH * (TIC80_FULLHEIGHT + 1) * sizeof(u32));
 #endif
     core->memory.samples.size = samplerate * TIC_STEREO_CHANNELS / TIC80_FRAMERATE * sizeof(s16);
-    core->memory.samples.buffer = malloc(core->memory.samples.size);
+    core->memory.samples.buffer = malloc(TIC_FRAME_SAMPLES_MAX(samplerate) * TIC_STEREO_CHANNELS * sizeof(s16));
 
     core->blip.left = blip_new(samplerate / 10);
     core->blip.right = blip_new(samplerate / 10);
@@ -762,6 +1043,14 @@ tic_mem* tic_core_create(s32 samplerate)
     blip_set_rates(core->blip.left, CLOCKRATE, samplerate);
     blip_set_rates(core->blip.right, CLOCKRATE, samplerate);
 
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    core->deferred = tic_deferred_create(&core->memory, 0);
+#endif
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+    core->synth = tic_synth_create(&core->memory);
+#endif
+
     tic_api_reset(&core->memory);
 
     return &core->memory;
@@ -24,6 +24,7 @@
 
 #include "api.h"
 #include "tools.h"
+#include "tilesheet.h"
 #include "blip_buf.h"
 
 #define CLOCKRATE (255<<13)
@@ -102,6 +103,15 @@ typedef struct
     s32 beat;
 } tic_jump_command;
 
+typedef struct
+{
+    s32 ticks;
+    tic_channel_data channels[TIC_SOUND_CHANNELS];
+    tic_command_data commands[TIC_SOUND_CHANNELS];
+    tic_sfx_pos sfxpos[TIC_SOUND_CHANNELS];
+    tic_jump_command jump;
+} tic_music_state_data;
+
 typedef struct
 {
 
@@ -132,18 +142,11 @@ typedef struct
         tic_channel_data channels[TIC_SOUND_CHANNELS];
     } sfx;
 
-    struct
-    {
-        s32 ticks;
-        tic_channel_data channels[TIC_SOUND_CHANNELS];
-        tic_command_data commands[TIC_SOUND_CHANNELS];
-        tic_sfx_pos sfxpos[TIC_SOUND_CHANNELS];
-        tic_jump_command jump;
-
-    } music;
+    tic_music_state_data music;
 
     tic_tick tick;
     tic_scanline scanline;
+    tic_idle idle;
 
     struct
     {
@@ -155,12 +158,76 @@ typedef struct
     void (*setpix)(tic_mem* memory, s32 x, s32 y, u8 color);
     u8 (*getpix)(tic_mem* memory, s32 x, s32 y);
     void (*drawhline)(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color);
+    void (*drawvline)(tic_mem* memory, s32 x, s32 yt, s32 yb, u8 color);
 
     u32 synced;
 
     bool initialized;
 } tic_core_state_data;
 
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+typedef struct tic_deferred tic_deferred;
+#endif
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+typedef struct tic_synth tic_synth;
+#endif
+
+// opaque pixel masks of a font glyph, rebuilt when its source tile changes
+typedef struct
+{
+    const tic_blit_segment* segment;
+    u32 offset;
+    u16 transparent;
+    u8 raw[sizeof(tic_tile)];
+    u8 rows[TIC_SPRITESIZE];
+    u8 start;
+    u8 width;
+} tic_glyph;
+
+typedef struct
+{
+    tic_glyph print[TIC_FONT_CHARS];
+    tic_glyph font[TIC_FONT_CHARS];
+} tic_glyph_cache;
+
+// sfx positions past this repeat the loops, see sfxTickPos()
+#define SFX_TABLE_TICKS (SFX_TICKS * 2)
+
+// per-tick sfx parameters with the loops applied, rebuilt when the sample changes
+typedef struct
+{
+    tic_sample raw;
+    bool ready;
+
+    struct
+    {
+        u8 pos;
+        s8 value;
+    } ticks[sizeof(tic_sfx_pos)][SFX_TABLE_TICKS];
+} tic_sfx_table;
+
+// playback state right before a row is first played
+typedef struct
+{
+    s8 frame;
+    s8 row;
+    tic_music_state_data music;
+} tic_music_checkpoint;
+
+// a track played once from the start with jumps ignored, rebuilt when the music or sfx change
+typedef struct
+{
+    tic_music music;
+    tic_samples samples;
+    s32 track;
+    bool sustain;
+
+    s32 duration;
+    s32 start[MUSIC_FRAMES]; // first tick of every frame, -1 past the end of the track
+    tic_music_checkpoint rows[MUSIC_FRAMES][MUSIC_PATTERN_ROWS];
+} tic_music_index;
+
 typedef struct
 {
     tic_mem memory; // it should be first
@@ -185,6 +252,22 @@ typedef struct
 
     };
 
+    // TIC/SCN/OVR handles the bindings keep for their VM, freed with it
+    struct
+    {
+#if defined(TIC_BUILD_WITH_LUA) || defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+        struct tic_lua_callbacks* lua;
+#endif
+
+#if defined(TIC_BUILD_WITH_JS)
+        struct tic_js_callbacks* js;
+#endif
+
+#if defined(TIC_BUILD_WITH_SQUIRREL)
+        struct tic_squirrel_callbacks* squirrel;
+#endif
+    } callbacks;
+
     struct
     {
         blip_buffer_t* left;
@@ -195,8 +278,32 @@ typedef struct
 
     tic_tick_data* data;
 
+    // times the script TIC/SCN/OVR callbacks were looked up and changed since the cart started
+    u32 callbackResolves;
+
+    struct
+    {
+        u64 average; // script tick, counter units
+        tic_tick_stats stats;
+    } timing;
+
     tic_core_state_data state;
 
+    s32 depth[TIC80_WIDTH * TIC80_HEIGHT];
+
+    tic_glyph_cache glyphs;
+
+    tic_sfx_table sfx[SFX_COUNT];
+    tic_music_index* seek;
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    tic_deferred* deferred;
+#endif
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+    tic_synth* synth;
+#endif
+
     struct
     {
         tic_core_state_data state;   
@@ -212,6 +319,32 @@ typedef struct
 
 } tic_core;
 
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+tic_deferred* tic_deferred_create(tic_mem* memory, s32 bands);
+void tic_deferred_close(tic_deferred* deferred);
+void tic_deferred_begin(tic_mem* memory);
+void tic_deferred_end(tic_mem* memory);
+void tic_deferred_flush(tic_mem* memory, s32 address, s32 size);
+void tic_deferred_direct(tic_mem* memory, bool direct);
+void tic_deferred_immediate(tic_mem* memory, bool immediate);
+void* tic_deferred_alloc(tic_mem* memory, s32 size);
+void tic_deferred_touch(tic_mem* memory, s32 address, s32 size);
+void tic_draw_replay(tic_mem* memory, const u8* commands, s32 size, s32 top, s32 bottom, tic_glyph_cache* glyphs);
+#   define FLUSH_DEFERRED(memory, address, size) tic_deferred_flush(memory, address, size)
+#else
+#   define FLUSH_DEFERRED(memory, address, size)
+#endif
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+tic_synth* tic_synth_create(tic_mem* memory);
+void tic_synth_close(tic_synth* synth);
+s32 tic_synth_push(tic_synth* synth, s16* samples);
+void tic_synth_sync(tic_synth* synth);
+#   define SYNC_SYNTH(core) if ((core)->synth) tic_synth_sync((core)->synth)
+#else
+#   define SYNC_SYNTH(core)
+#endif
+
 #if defined(TIC_BUILD_WITH_SQUIRREL)
 const tic_script_config* getSquirrelScriptConfig();
 #endif
@@ -240,3 +373,4 @@ const tic_script_config* getWrenScriptConfig();
 void tic_core_tick_io(tic_mem* memory);
 void tic_core_sound_tick_start(tic_mem* memory);
 void tic_core_sound_tick_end(tic_mem* memory);
+s32 tic_core_sound_synth(tic_core* core, const tic_sound_register* registers, const tic_stereo_volume* stereo, s16* samples);
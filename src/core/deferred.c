@@ -0,0 +1,323 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core.h"
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+// Draw calls made from TIC() are recorded with their arguments and the clip
+// rect, see tic_draw_replay(). The frame is split into bands of rows and every
+// band runs the recorded calls through the rasterizers on its own thread,
+// clipped to its rows. Bands never share a byte of VRAM and keep the recorded
+// order, so the result is the same as drawing immediately. The recording is
+// flushed before anything the calls read or write is touched from the script.
+
+#define DEFERRED_BUFFER_SIZE (1024 * 1024)
+#define DEFERRED_MAX_BANDS 8
+#define DEFERRED_PAGE_SIZE 1024
+
+// smaller batches are replayed on the calling thread
+#define DEFERRED_PARALLEL_COMMANDS 32
+
+typedef struct
+{
+    tic_deferred* deferred;
+    s32 band;
+    tic_glyph_cache glyphs;
+} BandWorker;
+
+struct tic_deferred
+{
+    u64 commands[DEFERRED_BUFFER_SIZE / sizeof(u64)];
+    s32 size;
+    s32 count;
+
+    // RAM pages read by the recorded calls besides the vram, sheets, map and font
+    bool pages[TIC_RAM_SIZE / DEFERRED_PAGE_SIZE];
+
+    bool recording;
+
+    // the script holds a view of the memory, so draw immediately
+    bool direct;
+
+    // nesting of calls that draw immediately, like map() with a remap callback
+    s32 immediate;
+
+    tic_mem* memory;
+
+    s32 bands;
+    BandWorker workers[DEFERRED_MAX_BANDS];
+    pthread_t threads[DEFERRED_MAX_BANDS];
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    u32 job;
+    s32 pending;
+    bool quit;
+};
+
+static inline s32 bandTop(const tic_deferred* deferred, s32 band)
+{
+    return band * TIC80_HEIGHT / deferred->bands;
+}
+
+static void drawBand(tic_deferred* deferred, s32 band)
+{
+    tic_draw_replay(deferred->memory, (const u8*)deferred->commands, deferred->size,
+        bandTop(deferred, band), bandTop(deferred, band + 1), &deferred->workers[band].glyphs);
+}
+
+static void* bandThread(void* data)
+{
+    BandWorker* worker = data;
+    tic_deferred* deferred = worker->deferred;
+    u32 job = 0;
+
+    pthread_mutex_lock(&deferred->lock);
+
+    for (;;)
+    {
+        while (!deferred->quit && deferred->job == job)
+            pthread_cond_wait(&deferred->start, &deferred->lock);
+
+        if (deferred->quit) break;
+
+        job = deferred->job;
+        pthread_mutex_unlock(&deferred->lock);
+
+        drawBand(deferred, worker->band);
+
+        pthread_mutex_lock(&deferred->lock);
+        if (--deferred->pending == 0)
+            pthread_cond_signal(&deferred->done);
+    }
+
+    pthread_mutex_unlock(&deferred->lock);
+
+    return NULL;
+}
+
+static void flushCommands(tic_deferred* deferred)
+{
+    if (deferred->count == 0) return;
+
+    if (deferred->bands == 1 || deferred->count < DEFERRED_PARALLEL_COMMANDS)
+        tic_draw_replay(deferred->memory, (const u8*)deferred->commands, deferred->size, 0, TIC80_HEIGHT, &deferred->workers[0].glyphs);
+    else
+    {
+        pthread_mutex_lock(&deferred->lock);
+        deferred->job++;
+        deferred->pending = deferred->bands - 1;
+        pthread_cond_broadcast(&deferred->start);
+        pthread_mutex_unlock(&deferred->lock);
+
+        drawBand(deferred, 0);
+
+        pthread_mutex_lock(&deferred->lock);
+        while (deferred->pending)
+            pthread_cond_wait(&deferred->done, &deferred->lock);
+        pthread_mutex_unlock(&deferred->lock);
+    }
+
+    deferred->size = 0;
+    deferred->count = 0;
+    memset(deferred->pages, 0, sizeof deferred->pages);
+}
+
+static inline tic_deferred* getDeferred(tic_mem* memory)
+{
+    return ((tic_core*)memory)->deferred;
+}
+
+static inline bool overlaps(s32 address, s32 size, s32 start, s32 end)
+{
+    return address < end && address + size > start;
+}
+
+// true when the RAM range is read or written by the recorded calls
+static bool isDrawMemory(const tic_deferred* deferred, s32 address, s32 size)
+{
+    if (overlaps(address, size, 0, offsetof(tic_ram, input))
+        || overlaps(address, size, offsetof(tic_ram, font), offsetof(tic_ram, font) + sizeof(tic_font)))
+        return true;
+
+    s32 first = MAX(address, 0) / DEFERRED_PAGE_SIZE;
+    s32 last = MIN(address + size - 1, TIC_RAM_SIZE - 1) / DEFERRED_PAGE_SIZE;
+
+    for (s32 i = first; i <= last; i++)
+        if (deferred->pages[i])
+            return true;
+
+    return false;
+}
+
+tic_deferred* tic_deferred_create(tic_mem* memory, s32 bands)
+{
+    tic_deferred* deferred = (tic_deferred*)malloc(sizeof(tic_deferred));
+
+    if (!deferred) return NULL;
+
+    memset(deferred, 0, sizeof(tic_deferred));
+    deferred->memory = memory;
+
+    pthread_mutex_init(&deferred->lock, NULL);
+    pthread_cond_init(&deferred->start, NULL);
+    pthread_cond_init(&deferred->done, NULL);
+
+    // one band per CPU by default
+    if (bands <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        bands = cores < 1 ? 1 : (s32)MIN(cores, DEFERRED_MAX_BANDS);
+    }
+
+    bands = MIN(bands, DEFERRED_MAX_BANDS);
+
+    // band 0 is drawn by the flushing thread
+    deferred->bands = 1;
+    for (s32 i = 1; i < bands; i++)
+    {
+        deferred->workers[i].deferred = deferred;
+        deferred->workers[i].band = i;
+
+        if (pthread_create(&deferred->threads[i], NULL, bandThread, &deferred->workers[i]) != 0)
+            break;
+
+        deferred->bands++;
+    }
+
+    return deferred;
+}
+
+void tic_deferred_close(tic_deferred* deferred)
+{
+    pthread_mutex_lock(&deferred->lock);
+    deferred->quit = true;
+    pthread_cond_broadcast(&deferred->start);
+    pthread_mutex_unlock(&deferred->lock);
+
+    for (s32 i = 1; i < deferred->bands; i++)
+        pthread_join(deferred->threads[i], NULL);
+
+    pthread_cond_destroy(&deferred->done);
+    pthread_cond_destroy(&deferred->start);
+    pthread_mutex_destroy(&deferred->lock);
+
+    free(deferred);
+}
+
+void tic_deferred_begin(tic_mem* memory)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred || deferred->direct) return;
+
+    deferred->recording = true;
+    deferred->immediate = 0;
+}
+
+void tic_deferred_end(tic_mem* memory)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred) return;
+
+    flushCommands(deferred);
+    deferred->recording = false;
+}
+
+void tic_deferred_direct(tic_mem* memory, bool direct)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred) return;
+
+    if (direct)
+        tic_deferred_end(memory);
+
+    deferred->direct = direct;
+}
+
+void tic_deferred_immediate(tic_mem* memory, bool immediate)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred) return;
+
+    if (immediate)
+    {
+        flushCommands(deferred);
+        deferred->immediate++;
+    }
+    else deferred->immediate--;
+}
+
+void* tic_deferred_alloc(tic_mem* memory, s32 size)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred || !deferred->recording || deferred->immediate) return NULL;
+
+    if (deferred->size + size > (s32)sizeof deferred->commands)
+    {
+        flushCommands(deferred);
+
+        // too big to record, it's drawn right away after everything before it
+        if (size > (s32)sizeof deferred->commands)
+            return NULL;
+    }
+
+    void* command = (u8*)deferred->commands + deferred->size;
+    deferred->size += size;
+    deferred->count++;
+
+    return command;
+}
+
+void tic_deferred_touch(tic_mem* memory, s32 address, s32 size)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (!deferred || size <= 0) return;
+
+    s32 first = MAX(address, 0) / DEFERRED_PAGE_SIZE;
+    s32 last = MIN(address + size - 1, TIC_RAM_SIZE - 1) / DEFERRED_PAGE_SIZE;
+
+    for (s32 i = first; i <= last; i++)
+        deferred->pages[i] = true;
+}
+
+void tic_deferred_flush(tic_mem* memory, s32 address, s32 size)
+{
+    tic_deferred* deferred = getDeferred(memory);
+
+    if (deferred && deferred->count && size > 0 && isDrawMemory(deferred, address, size))
+        flushCommands(deferred);
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #define TRANSPARENT_COLOR 255
 
@@ -43,11 +44,85 @@ static tic_tilesheet getTileSheetFromSegment(tic_mem* memory, u8 segment)
     return tic_tilesheet_get(segment, src);
 }
 
-static u8* getPalette(tic_mem* tic, u8* colors, u8 count)
+// where the rasterizers draw, deferred drawing replays every band of rows
+// with its own canvas so the bands can be drawn at the same time
+typedef struct
+{
+    tic_core* core;
+    tic_clip_data clip;
+    s32 top, bottom;
+    tic_glyph_cache* glyphs;
+} Canvas;
+
+static inline Canvas getCanvas(tic_core* core)
+{
+    return (Canvas){ core, core->state.clip, 0, TIC80_HEIGHT, &core->glyphs };
+}
+
+typedef enum
+{
+    DrawCls,
+    DrawPix,
+    DrawLine,
+    DrawRect,
+    DrawRectBorder,
+    DrawCircle,
+    DrawCircleBorder,
+    DrawEllipse,
+    DrawEllipseBorder,
+    DrawTriangle,
+    DrawTexturedTriangle,
+    DrawMesh,
+    DrawSprite,
+    DrawSprites,
+    DrawMap,
+    DrawPrint,
+    DrawFont,
+} DrawType;
+
+typedef struct { u8 color; } ClsArgs;
+typedef struct { s32 x, y; u8 color; } PixArgs;
+typedef struct { s32 x0, y0, x1, y1; u8 color; } LineArgs;
+typedef struct { s32 x, y, w, h; u8 color; } RectArgs;
+typedef struct { s32 x, y, a, b; u8 color; } EllipseArgs;
+typedef struct { s32 x1, y1, x2, y2, x3, y3; u8 color; } TriangleArgs;
+typedef struct { float x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, z1, z2, z3; s32 count; bool use_map, perspective; } TexturedTriangleArgs;
+typedef struct { s32 vertices, indices, count, uvs, colorCount; u8 color, flags; bool use_map; } MeshArgs;
+typedef struct { s32 index, x, y, w, h, count, scale; tic_flip flip; tic_rotate rotate; } SpriteArgs;
+typedef struct { s32 count; } SpritesArgs;
+typedef struct { s32 x, y, w, h, sx, sy, count, scale; } MapArgs;
+typedef struct { s32 x, y, w, h, scale; u8 color; bool fixed, alt; } TextArgs;
+
+// a draw call with its arguments, colors, sprite records or text follow it
+typedef struct
+{
+    DrawType type;
+    s32 size;
+    tic_clip_data clip;
+
+    union
+    {
+        ClsArgs cls;
+        PixArgs pix;
+        LineArgs line;
+        RectArgs rect;
+        EllipseArgs ellipse;
+        TriangleArgs tri;
+        TexturedTriangleArgs textri;
+        MeshArgs mesh;
+        SpriteArgs spr;
+        SpritesArgs sprs;
+        MapArgs map;
+        TextArgs text;
+    };
+} DrawCommand;
+
+static s32 drawCommand(tic_mem* memory, DrawCommand* command, const void* data, s32 size);
+
+static u8* getPalette(tic_mem* tic, u8* mapping, const u8* colors, u8 count)
 {
-    static u8 mapping[TIC_PALETTE_SIZE];
     for (s32 i = 0; i < TIC_PALETTE_SIZE; i++) mapping[i] = tic_tool_peek4(tic->ram.vram.mapping, i);
-    for (s32 i = 0; i < count; i++) mapping[colors[i]] = TRANSPARENT_COLOR;
+    for (s32 i = 0; i < count; i++) if (colors[i] < TIC_PALETTE_SIZE) mapping[colors[i]] = TRANSPARENT_COLOR;
     return mapping;
 }
 
@@ -56,11 +131,11 @@ static inline u8 mapColor(tic_mem* tic, u8 color)
     return tic_tool_peek4(tic->ram.vram.mapping, color & 0xf);
 }
 
-static void setPixel(tic_core* core, s32 x, s32 y, u8 color)
+static void setPixel(Canvas* canvas, s32 x, s32 y, u8 color)
 {
-    if (x < core->state.clip.l || y < core->state.clip.t || x >= core->state.clip.r || y >= core->state.clip.b) return;
+    if (x < canvas->clip.l || y < canvas->clip.t || x >= canvas->clip.r || y >= canvas->clip.b) return;
 
-    core->state.setpix(&core->memory, x, y, color);
+    canvas->core->state.setpix(&canvas->core->memory, x, y, color);
 }
 
 static u8 getPixel(tic_core* core, s32 x, s32 y)
@@ -72,46 +147,45 @@ static u8 getPixel(tic_core* core, s32 x, s32 y)
 
 #define EARLY_CLIP(x, y, width, height) \
     ( \
-        (((y)+(height)-1) < core->state.clip.t) \
-        || (((x)+(width)-1) < core->state.clip.l) \
-        || ((y) >= core->state.clip.b) \
-        || ((x) >= core->state.clip.r) \
+        (((y)+(height)-1) < canvas->clip.t) \
+        || (((x)+(width)-1) < canvas->clip.l) \
+        || ((y) >= canvas->clip.b) \
+        || ((x) >= canvas->clip.r) \
     )
 
-static void drawHLine(tic_core* core, s32 x, s32 y, s32 width, u8 color)
+static void drawHLine(Canvas* canvas, s32 x, s32 y, s32 width, u8 color)
 {
-    if (y < core->state.clip.t || core->state.clip.b <= y) return;
+    if (y < canvas->clip.t || canvas->clip.b <= y) return;
 
-    s32 xl = MAX(x, core->state.clip.l);
-    s32 xr = MIN(x + width, core->state.clip.r);
+    s32 xl = MAX(x, canvas->clip.l);
+    s32 xr = MIN(x + width, canvas->clip.r);
 
-    core->state.drawhline(&core->memory, xl, xr, y, color);
+    canvas->core->state.drawhline(&canvas->core->memory, xl, xr, y, color);
 }
 
-static void drawVLine(tic_core* core, s32 x, s32 y, s32 height, u8 color)
+static void drawVLine(Canvas* canvas, s32 x, s32 y, s32 height, u8 color)
 {
-    if (x < core->state.clip.l || core->state.clip.r <= x) return;
+    if (x < canvas->clip.l || canvas->clip.r <= x) return;
 
-    s32 yl = y < 0 ? 0 : y;
-    s32 yr = y + height >= TIC80_HEIGHT ? TIC80_HEIGHT : y + height;
+    s32 yt = MAX(y, canvas->clip.t);
+    s32 yb = MIN(y + height, canvas->clip.b);
 
-    for (s32 i = yl; i < yr; ++i)
-        setPixel(core, x, i, color);
+    canvas->core->state.drawvline(&canvas->core->memory, x, yt, yb, color);
 }
 
-static void drawRect(tic_core* core, s32 x, s32 y, s32 width, s32 height, u8 color)
+static void drawRect(Canvas* canvas, s32 x, s32 y, s32 width, s32 height, u8 color)
 {
     for (s32 i = y; i < y + height; ++i)
-        drawHLine(core, x, i, width, color);
+        drawHLine(canvas, x, i, width, color);
 }
 
-static void drawRectBorder(tic_core* core, s32 x, s32 y, s32 width, s32 height, u8 color)
+static void drawRectBorder(Canvas* canvas, s32 x, s32 y, s32 width, s32 height, u8 color)
 {
-    drawHLine(core, x, y, width, color);
-    drawHLine(core, x, y + height - 1, width, color);
+    drawHLine(canvas, x, y, width, color);
+    drawHLine(canvas, x, y + height - 1, width, color);
 
-    drawVLine(core, x, y, height, color);
-    drawVLine(core, x + width - 1, y, height, color);
+    drawVLine(canvas, x, y, height, color);
+    drawVLine(canvas, x + width - 1, y, height, color);
 }
 
 #define DRAW_TILE_BODY(X, Y) do {\
@@ -128,9 +202,11 @@ static void drawRectBorder(tic_core* core, s32 x, s32 y, s32 width, s32 height,
 
 #define REVERT(X) (TIC_SPRITESIZE - 1 - (X))
 
-static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
+static void drawTile(Canvas* canvas, tic_tileptr* tile, s32 x, s32 y, const u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
 {
-    u8* mapping = getPalette(&core->memory, colors, count);
+    tic_core* core = canvas->core;
+    u8 mapping[TIC_PALETTE_SIZE];
+    getPalette(&core->memory, mapping, colors, count);
 
     rotate &= 0b11;
     u32 orientation = flip & 0b11;
@@ -143,10 +219,10 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
     if (scale == 1) {
         // the most common path
         s32 sx, sy, ex, ey;
-        sx = core->state.clip.l - x; if (sx < 0) sx = 0;
-        sy = core->state.clip.t - y; if (sy < 0) sy = 0;
-        ex = core->state.clip.r - x; if (ex > TIC_SPRITESIZE) ex = TIC_SPRITESIZE;
-        ey = core->state.clip.b - y; if (ey > TIC_SPRITESIZE) ey = TIC_SPRITESIZE;
+        sx = canvas->clip.l - x; if (sx < 0) sx = 0;
+        sy = canvas->clip.t - y; if (sy < 0) sy = 0;
+        ex = canvas->clip.r - x; if (ex > TIC_SPRITESIZE) ex = TIC_SPRITESIZE;
+        ey = canvas->clip.b - y; if (ey > TIC_SPRITESIZE) ey = TIC_SPRITESIZE;
         y += sy;
         x += sx;
         switch (orientation) {
@@ -175,7 +251,7 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
                 s32 tmp = ix; ix = iy; iy = tmp;
             }
             u8 color = mapping[tic_tilesheet_gettilepix(tile, ix, iy)];
-            if (color != TRANSPARENT_COLOR) drawRect(core, xx, y, scale, scale, color);
+            if (color != TRANSPARENT_COLOR) drawRect(canvas, xx, y, scale, scale, color);
         }
     }
 }
@@ -183,12 +259,13 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
 #undef DRAW_TILE_BODY
 #undef REVERT
 
-static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
+static void drawSprite(Canvas* canvas, s32 index, s32 x, s32 y, s32 w, s32 h, const u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
 {
-    tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    tic_mem* memory = &canvas->core->memory;
+    tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
     if (w == 1 && h == 1) {
         tic_tileptr tile = tic_tilesheet_gettile(&sheet, index, false);
-        drawTile(core, &tile, x, y, colors, count, scale, flip, rotate);
+        drawTile(canvas, &tile, x, y, colors, count, scale, flip, rotate);
     }
     else
     {
@@ -230,19 +307,20 @@ static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8
 
                 tic_tileptr tile = tic_tilesheet_gettile(&sheet, index + mx + my * cols, false);
                 if (rotate == 0 || rotate == 2)
-                    drawTile(core, &tile, x + i * step, y + j * step, colors, count, scale, flip, rotate);
+                    drawTile(canvas, &tile, x + i * step, y + j * step, colors, count, scale, flip, rotate);
                 else
-                    drawTile(core, &tile, x + j * step, y + i * step, colors, count, scale, flip, rotate);
+                    drawTile(canvas, &tile, x + j * step, y + i * step, colors, count, scale, flip, rotate);
             }
         }
     }
 }
 
-static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)
+static void drawMap(Canvas* canvas, const tic_map* src, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, const u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)
 {
     const s32 size = TIC_SPRITESIZE * scale;
 
-    tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    tic_mem* memory = &canvas->core->memory;
+    tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
 
     for (s32 j = y, jj = sy; j < y + height; j++, jj += size)
         for (s32 i = x, ii = sx; i < x + width; i++, ii += size)
@@ -262,51 +340,121 @@ static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width,
                 remap(data, mi, mj, &retile);
 
             tic_tileptr tile = tic_tilesheet_gettile(&sheet, retile.index, true);
-            drawTile(core, &tile, ii, jj, colors, count, scale, retile.flip, retile.rotate);
+            drawTile(canvas, &tile, ii, jj, colors, count, scale, retile.flip, retile.rotate);
         }
 }
 
-static s32 drawChar(tic_core* core, tic_tileptr* font_char, s32 x, s32 y, s32 scale, bool fixed, u8* mapping)
+static const tic_glyph* getGlyph(tic_glyph* cache, const tic_tileptr* tile, s32 index, const u8* mapping, u16 transparent)
 {
     enum { Size = TIC_SPRITESIZE };
 
-    s32 j = 0, start = 0, end = Size;
+    tic_glyph* glyph = &cache[index & (TIC_FONT_CHARS - 1)];
+    size_t size = tile->segment->ptr_size;
 
-    if (!fixed) {
-        for (s32 i = 0; i < Size; i++) {
-            for (j = 0; j < Size; j++)
-                if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
-            if (j < Size) break; else start++;
-        }
-        for (s32 i = Size - 1; i >= start; i--) {
-            for (j = 0; j < Size; j++)
-                if (mapping[tic_tilesheet_gettilepix(font_char, i, j)] != TRANSPARENT_COLOR) break;
-            if (j < Size) break; else end--;
-        }
+    if (glyph->segment == tile->segment && glyph->offset == tile->offset
+        && glyph->transparent == transparent && memcmp(glyph->raw, tile->ptr, size) == 0)
+        return glyph;
+
+    glyph->segment = tile->segment;
+    glyph->offset = tile->offset;
+    glyph->transparent = transparent;
+    memcpy(glyph->raw, tile->ptr, size);
+
+    u8 columns = 0;
+    for (s32 j = 0; j < Size; j++)
+    {
+        u8 row = 0;
+        for (s32 i = 0; i < Size; i++)
+            if (mapping[tic_tilesheet_gettilepix(tile, i, j)] != TRANSPARENT_COLOR)
+                row |= 1 << i;
+
+        glyph->rows[j] = row;
+        columns |= row;
     }
-    s32 width = end - start;
 
-    if (EARLY_CLIP(x, y, Size * scale, Size * scale)) return width;
+    s32 start = 0, end = Size;
+    if (columns)
+    {
+        while (!(columns & (1 << start))) start++;
+        while (!(columns & (1 << (end - 1)))) end--;
+    }
+    else start = end = 0;
 
-    s32 colStart = start, colStep = 1, rowStart = 0, rowStep = 1;
+    glyph->start = start;
+    glyph->width = end - start;
+
+    return glyph;
+}
+
+static void drawGlyphSpan(Canvas* canvas, s32 x, s32 y, s32 width, s32 height, u8 color, bool clipped)
+{
+    if (clipped)
+        drawRect(canvas, x, y, width, height, color);
+    else
+        for (s32 i = y; i < y + height; i++)
+            canvas->core->state.drawhline(&canvas->core->memory, x, x + width, i, color);
+}
 
-    for (s32 i = 0, col = colStart, xs = x; i < width; i++, col += colStep, xs += scale)
+static s32 drawChar(Canvas* canvas, const tic_glyph* glyph, const tic_tileptr* font_char, s32 x, s32 y, s32 scale, bool fixed, const u8* mapping, bool mono, bool clipped)
+{
+    enum { Size = TIC_SPRITESIZE };
+
+    s32 start = fixed ? 0 : glyph->start;
+    s32 width = fixed ? Size : glyph->width;
+
+    if (clipped && EARLY_CLIP(x, y, Size * scale, Size * scale)) return width;
+
+    for (s32 row = 0, ys = y; row < Size; row++, ys += scale)
     {
-        for (s32 j = 0, row = rowStart, ys = y; j < Size; j++, row += rowStep, ys += scale)
+        u32 mask = glyph->rows[row] >> start;
+
+        for (s32 col = 0; mask;)
         {
-            u8 color = tic_tilesheet_gettilepix(font_char, col, row);
-            if (mapping[color] != TRANSPARENT_COLOR)
-                drawRect(core, xs, ys, scale, scale, mapping[color]);
+            while (!(mask & 1)) mask >>= 1, col++;
+
+            s32 first = col;
+            while (mask & 1) mask >>= 1, col++;
+
+            if (mono)
+                drawGlyphSpan(canvas, x + first * scale, ys, (col - first) * scale, scale, mapping[1], clipped);
+            else
+                for (s32 i = first; i < col; i++)
+                    drawGlyphSpan(canvas, x + i * scale, ys, scale, scale,
+                        mapping[tic_tilesheet_gettilepix(font_char, start + i, row)], clipped);
         }
     }
+
     return width;
 }
 
-static s32 drawText(tic_core* core, tic_tilesheet* font_face, const char* text, s32 x, s32 y, s32 width, s32 height, bool fixed, u8* mapping, s32 scale, bool alt)
+// conservative check that nothing drawText emits can leave the clip rect
+static bool isTextInsideClip(Canvas* canvas, const char* text, s32 x, s32 y, s32 width, s32 height, s32 scale)
+{
+    enum { Size = TIC_SPRITESIZE };
+
+    if (scale < 1 || width < 0 || height < 0) return false;
+
+    s32 lines = 1, chars = 0, maxChars = 0;
+    for (const char* c = text; *c; c++)
+        if (*c == '\n') lines++, chars = 0;
+        else if (++chars > maxChars) maxChars = chars;
+
+    if (maxChars == 0) return true;
+
+    s64 advance = (s64)MAX(width, Size + 1) * scale;
+    s64 right = x + (maxChars - 1) * advance + (s64)Size * scale;
+    s64 bottom = y + (s64)(lines - 1) * height * scale + (s64)Size * scale;
+
+    const tic_clip_data* clip = &canvas->clip;
+    return x >= clip->l && y >= clip->t && right <= clip->r && bottom <= clip->b;
+}
+
+static s32 drawText(Canvas* canvas, tic_glyph* cache, tic_tilesheet* font_face, const char* text, s32 x, s32 y, s32 width, s32 height, bool fixed, u8* mapping, u16 transparent, bool mono, s32 scale, bool alt)
 {
     s32 pos = x;
     s32 MAX = x;
     char sym = 0;
+    bool clipped = !isTextInsideClip(canvas, text, x, y, width, height, scale);
 
     while ((sym = *text++))
     {
@@ -319,8 +467,10 @@ static s32 drawText(tic_core* core, tic_tilesheet* font_face, const char* text,
             y += height * scale;
         }
         else {
-            tic_tileptr font_char = tic_tilesheet_gettile(font_face, alt * TIC_FONT_CHARS / 2 + sym, true);
-            s32 size = drawChar(core, &font_char, pos, y, scale, fixed, mapping);
+            s32 index = alt * TIC_FONT_CHARS / 2 + sym;
+            tic_tileptr font_char = tic_tilesheet_gettile(font_face, index, true);
+            const tic_glyph* glyph = getGlyph(cache, &font_char, index, mapping, transparent);
+            s32 size = drawChar(canvas, glyph, &font_char, pos, y, scale, fixed, mapping, mono, clipped);
             pos += ((!fixed && size) ? size + 1 : width) * scale;
         }
     }
@@ -345,31 +495,43 @@ void tic_api_clip(tic_mem* memory, s32 x, s32 y, s32 width, s32 height)
 
 void tic_api_rect(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, u8 color)
 {
-    tic_core* core = (tic_core*)memory;
-
-    drawRect(core, x, y, width, height, mapColor(memory, color));
+    drawCommand(memory, &(DrawCommand){ DrawRect, .rect = { x, y, width, height, color } }, NULL, 0);
 }
 
-void tic_api_cls(tic_mem* memory, u8 color)
+static void clearScreen(Canvas* canvas, const tic_clip_data* clip, u8 color)
 {
     static const tic_clip_data EmptyClip = { 0, 0, TIC80_WIDTH, TIC80_HEIGHT };
 
-    tic_core* core = (tic_core*)memory;
+    tic_mem* memory = &canvas->core->memory;
 
-    if (memcmp(&core->state.clip, &EmptyClip, sizeof(tic_clip_data)) == 0)
+    if (memcmp(clip, &EmptyClip, sizeof(tic_clip_data)) == 0)
     {
+        enum { Row = TIC80_WIDTH * TIC_PALETTE_BPP / BITS_IN_BYTE };
+
         color &= 0b00001111;
-        memset(memory->ram.vram.screen.data, color | (color << TIC_PALETTE_BPP), sizeof(memory->ram.vram.screen.data));
+        memset(memory->ram.vram.screen.data + canvas->top * Row, color | (color << TIC_PALETTE_BPP), (canvas->bottom - canvas->top) * Row);
     }
     else
     {
-        tic_api_rect(memory, core->state.clip.l, core->state.clip.t, core->state.clip.r - core->state.clip.l, core->state.clip.b - core->state.clip.t, color);
+        drawRect(canvas, clip->l, clip->t, clip->r - clip->l, clip->b - clip->t, mapColor(memory, color));
     }
 }
 
-s32 tic_api_font(tic_mem* memory, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt)
+void tic_api_cls(tic_mem* memory, u8 color)
 {
-    u8* mapping = getPalette(memory, &chromakey, 1);
+    drawCommand(memory, &(DrawCommand){ DrawCls, .cls = { color } }, NULL, 0);
+}
+
+static s32 drawFont(Canvas* canvas, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt)
+{
+    tic_mem* memory = &canvas->core->memory;
+    u8 mapping[TIC_PALETTE_SIZE];
+    getPalette(memory, mapping, &chromakey, 1);
+
+    u16 transparent = 0;
+    for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+        if (mapping[i] == TRANSPARENT_COLOR)
+            transparent |= 1 << i;
 
     // Compatibility : flip top and bottom of the spritesheet
     // to preserve tic_api_font's default target
@@ -377,22 +539,71 @@ s32 tic_api_font(tic_mem* memory, const char* text, s32 x, s32 y, u8 chromakey,
     u8 flipmask = 1; while (segment >>= 1) flipmask <<= 1;
 
     tic_tilesheet font_face = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment ^ flipmask);
-    return drawText((tic_core*)memory, &font_face, text, x, y, w, h, fixed, mapping, scale, alt);
+    return drawText(canvas, canvas->glyphs->font, &font_face, text, x, y, w, h, fixed, mapping, transparent, false, scale, alt);
 }
 
-s32 tic_api_print(tic_mem* memory, const char* text, s32 x, s32 y, u8 color, bool fixed, s32 scale, bool alt)
+s32 tic_api_font(tic_mem* memory, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt)
+{
+    return drawCommand(memory, &(DrawCommand){ DrawFont, .text = { x, y, w, h, scale, chromakey, fixed, alt } }, text, (s32)strlen(text) + 1);
+}
+
+static s32 drawPrint(Canvas* canvas, const char* text, s32 x, s32 y, u8 color, bool fixed, s32 scale, bool alt)
 {
     u8 mapping[] = { 255, color };
-    tic_tilesheet font_face = getTileSheetFromSegment(memory, 1);
+    tic_tilesheet font_face = getTileSheetFromSegment(&canvas->core->memory, 1);
     // Compatibility : print uses reduced width for non-fixed space
     u8 width = alt ? TIC_ALTFONT_WIDTH : TIC_FONT_WIDTH;
     if (!fixed) width -= 2;
-    return drawText((tic_core*)memory, &font_face, text, x, y, width, TIC_FONT_HEIGHT, fixed, mapping, scale, alt);
+
+    // the glyph cache is keyed by the transparent colors, color 255 hides the text too
+    u16 transparent = color == TRANSPARENT_COLOR ? 3 : 1;
+    return drawText(canvas, canvas->glyphs->print, &font_face, text, x, y, width, TIC_FONT_HEIGHT, fixed, mapping, transparent, true, scale, alt);
+}
+
+s32 tic_api_print(tic_mem* memory, const char* text, s32 x, s32 y, u8 color, bool fixed, s32 scale, bool alt)
+{
+    return drawCommand(memory, &(DrawCommand){ DrawPrint, .text = { x, y, 0, 0, scale, color, fixed, alt } }, text, (s32)strlen(text) + 1);
 }
 
 void tic_api_spr(tic_mem* memory, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
 {
-    drawSprite((tic_core*)memory, index, x, y, w, h, colors, count, scale, flip, rotate);
+    count = MAX(count, 0);
+    drawCommand(memory, &(DrawCommand){ DrawSprite, .spr = { index, x, y, w, h, count, scale, flip, rotate } }, colors, count);
+}
+
+static void drawSprites(Canvas* canvas, const u8* records, s32 count)
+{
+    for(const u8 *rec = records, *end = records + count * TIC_SPRITE_RECORD_SIZE; rec != end; rec += TIC_SPRITE_RECORD_SIZE)
+    {
+        s32 index   = (u16)(rec[0] | rec[1] << 8);
+        s32 x       = (s16)(rec[2] | rec[3] << 8);
+        s32 y       = (s16)(rec[4] | rec[5] << 8);
+        u8 colorkey = rec[6];
+        s32 scale   = rec[7];
+        tic_flip flip = rec[8];
+        tic_rotate rotate = rec[9];
+        s32 w       = rec[10];
+        s32 h       = rec[11];
+
+        if(scale == 0 || w == 0 || h == 0) continue;
+
+        drawSprite(canvas, index, x, y, w, h, &colorkey, colorkey == TIC_SPRITE_RECORD_NOKEY ? 0 : 1, scale, flip, rotate);
+    }
+}
+
+void tic_api_sprs(tic_mem* memory, const u8* records, s32 size, s32 count)
+{
+    if(!records || size <= 0 || count <= 0) return;
+
+    count = MIN(count, size / TIC_SPRITE_RECORD_SIZE);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    // records can be read straight from the screen memory
+    if (records >= (const u8*)&memory->ram && records < (const u8*)&memory->ram + sizeof(tic_ram))
+        tic_deferred_flush(memory, (s32)(records - (const u8*)&memory->ram), count * TIC_SPRITE_RECORD_SIZE);
+#endif
+
+    drawCommand(memory, &(DrawCommand){ DrawSprites, .sprs = { count } }, records, count * TIC_SPRITE_RECORD_SIZE);
 }
 
 static inline u8* getFlag(tic_mem* memory, s32 index, u8 flag)
@@ -421,109 +632,199 @@ u8 tic_api_pix(tic_mem* memory, s32 x, s32 y, u8 color, bool get)
 {
     tic_core* core = (tic_core*)memory;
 
-    if (get) return getPixel(core, x, y);
+    if (get)
+    {
+        FLUSH_DEFERRED(memory, 0, sizeof(memory->ram.vram.screen));
+        return getPixel(core, x, y);
+    }
 
-    setPixel(core, x, y, mapColor(memory, color));
+    drawCommand(memory, &(DrawCommand){ DrawPix, .pix = { x, y, color } }, NULL, 0);
     return 0;
 }
 
 void tic_api_rectb(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, u8 color)
 {
-    tic_core* core = (tic_core*)memory;
-
-    drawRectBorder(core, x, y, width, height, mapColor(memory, color));
+    drawCommand(memory, &(DrawCommand){ DrawRectBorder, .rect = { x, y, width, height, color } }, NULL, 0);
 }
 
-static struct
+typedef struct
 {
     s16 Left[TIC80_HEIGHT];
     s16 Right[TIC80_HEIGHT];
-    s32 ULeft[TIC80_HEIGHT];
-    s32 VLeft[TIC80_HEIGHT];
 } SidesBuffer;
 
-static void initSidesBuffer()
+static void initSidesBuffer(SidesBuffer* sides)
 {
-    for (s32 i = 0; i < COUNT_OF(SidesBuffer.Left); i++)
-        SidesBuffer.Left[i] = TIC80_WIDTH, SidesBuffer.Right[i] = -1;
+    for (s32 i = 0; i < COUNT_OF(sides->Left); i++)
+        sides->Left[i] = TIC80_WIDTH, sides->Right[i] = -1;
 }
 
-static void setSidePixel(s32 x, s32 y)
+static void setSidePixel(SidesBuffer* sides, s32 x, s32 y)
 {
     if (y >= 0 && y < TIC80_HEIGHT)
     {
-        if (x < SidesBuffer.Left[y]) SidesBuffer.Left[y] = x;
-        if (x > SidesBuffer.Right[y]) SidesBuffer.Right[y] = x;
+        if (x < sides->Left[y]) sides->Left[y] = x;
+        if (x > sides->Right[y]) sides->Right[y] = x;
     }
 }
 
-static void setSideTexPixel(s32 x, s32 y, float u, float v)
+// shapes decide once whether their bounding box is inside the clip rect,
+// then write spans and pixels without per pixel checks
+static inline void drawShapeSpan(Canvas* canvas, s32 xl, s32 xr, s32 y, u8 color, bool inside)
+{
+    if (inside)
+        canvas->core->state.drawhline(&canvas->core->memory, xl, xr + 1, y, color);
+    else
+        drawHLine(canvas, xl, y, xr - xl + 1, color);
+}
+
+static inline void drawShapePixel(Canvas* canvas, s32 x, s32 y, u8 color, bool inside)
+{
+    if (inside)
+        canvas->core->state.setpix(&canvas->core->memory, x, y, color);
+    else
+        setPixel(canvas, x, y, color);
+}
+
+static inline bool isShapeInsideClip(Canvas* canvas, s32 x, s32 y, s32 rx, s32 ry)
+{
+    const tic_clip_data* clip = &canvas->clip;
+    return x - rx >= clip->l && x + rx < clip->r && y - ry >= clip->t && y + ry < clip->b;
+}
+
+static inline void drawCircleRows(Canvas* canvas, s32 xm, s32 ym, s32 dy, s32 half, u8 color, bool inside)
 {
-    s32 yy = y;
-    if (yy >= 0 && yy < TIC80_HEIGHT)
+    drawShapeSpan(canvas, xm - half, xm + half, ym - dy, color, inside);
+
+    if (dy)
+        drawShapeSpan(canvas, xm - half, xm + half, ym + dy, color, inside);
+}
+
+static void drawCircle(Canvas* canvas, s32 xm, s32 ym, s32 radius, u8 color)
+{
+    if (radius < 0 || EARLY_CLIP(xm - radius, ym - radius, radius * 2 + 1, radius * 2 + 1)) return;
+
+    u8 final_color = mapColor(&canvas->core->memory, color);
+    bool inside = isShapeInsideClip(canvas, xm, ym, radius, radius);
+
+    // same midpoint walk as circb, every row pair is filled once: rows up to
+    // the diagonal take their width from the first point on the row, rows
+    // past it from the last point before x steps
+    s32 x = -radius, y = 0, err = 2 - 2 * radius, row = -1;
+    do
     {
-        if (x < SidesBuffer.Left[yy])
-        {
-            SidesBuffer.Left[yy] = x;
-            SidesBuffer.ULeft[yy] = (s32)(u * 65536.0f);
-            SidesBuffer.VLeft[yy] = (s32)(v * 65536.0f);
-        }
-        if (x > SidesBuffer.Right[yy])
+        if (y != row && y <= -x)
         {
-            SidesBuffer.Right[yy] = x;
+            drawCircleRows(canvas, xm, ym, y, -x, final_color, inside);
+            row = y;
         }
-    }
+
+        s32 r = err, nx = x, ny = y;
+        if (r <= ny) err += ++ny * 2 + 1;
+        if (r > nx || err > ny) err += ++nx * 2 + 1;
+
+        if (nx != x && -x > y)
+            drawCircleRows(canvas, xm, ym, -x, y, final_color, inside);
+
+        x = nx, y = ny;
+    } while (x < 0);
 }
 
 void tic_api_circ(tic_mem* memory, s32 xm, s32 ym, s32 radius, u8 color)
 {
-    tic_core* core = (tic_core*)memory;
+    drawCommand(memory, &(DrawCommand){ DrawCircle, .ellipse = { xm, ym, radius, radius, color } }, NULL, 0);
+}
 
-    initSidesBuffer();
+static void drawCircleBorder(Canvas* canvas, s32 xm, s32 ym, s32 radius, u8 color)
+{
+    if (radius < 0 || EARLY_CLIP(xm - radius, ym - radius, radius * 2 + 1, radius * 2 + 1)) return;
 
-    s32 r = radius;
-    s32 x = -r, y = 0, err = 2 - 2 * r;
-    do
+    u8 final_color = mapColor(&canvas->core->memory, color);
+    bool inside = isShapeInsideClip(canvas, xm, ym, radius, radius);
+
+    if (radius == 0)
     {
-        setSidePixel(xm - x, ym + y);
-        setSidePixel(xm - y, ym - x);
-        setSidePixel(xm + x, ym - y);
-        setSidePixel(xm + y, ym + x);
+        drawShapePixel(canvas, xm, ym, final_color, inside);
+        return;
+    }
 
-        r = err;
+    // walk one octant and mirror it, the midpoint circle is symmetric
+    s32 x = -radius, y = 0, err = 2 - 2 * radius;
+    while (x < 0 && y <= -x)
+    {
+        drawShapePixel(canvas, xm - x, ym + y, final_color, inside);
+        drawShapePixel(canvas, xm + x, ym + y, final_color, inside);
+        drawShapePixel(canvas, xm - x, ym - y, final_color, inside);
+        drawShapePixel(canvas, xm + x, ym - y, final_color, inside);
+        drawShapePixel(canvas, xm + y, ym - x, final_color, inside);
+        drawShapePixel(canvas, xm - y, ym - x, final_color, inside);
+        drawShapePixel(canvas, xm + y, ym + x, final_color, inside);
+        drawShapePixel(canvas, xm - y, ym + x, final_color, inside);
+
+        s32 r = err;
         if (r <= y) err += ++y * 2 + 1;
         if (r > x || err > y) err += ++x * 2 + 1;
-    } while (x < 0);
-
-    s32 yt = MAX(core->state.clip.t, ym - radius);
-    s32 yb = MIN(core->state.clip.b, ym + radius + 1);
-    u8 final_color = mapColor(&core->memory, color);
-    for (s32 y = yt; y < yb; y++) {
-        s32 xl = MAX(SidesBuffer.Left[y], core->state.clip.l);
-        s32 xr = MIN(SidesBuffer.Right[y] + 1, core->state.clip.r);
-        core->state.drawhline(&core->memory, xl, xr, y, final_color);
     }
 }
 
 void tic_api_circb(tic_mem* memory, s32 xm, s32 ym, s32 radius, u8 color)
 {
-    tic_core* core = (tic_core*)memory;
-    u8 final_color = mapColor(memory, color);
-    s32 r = radius;
-    s32 x = -r, y = 0, err = 2 - 2 * r;
-    do {
-        setPixel(core, xm - x, ym + y, final_color);
-        setPixel(core, xm - y, ym - x, final_color);
-        setPixel(core, xm + x, ym - y, final_color);
-        setPixel(core, xm + y, ym + x, final_color);
-        r = err;
-        if (r <= y) err += ++y * 2 + 1;
-        if (r > x || err > y) err += ++x * 2 + 1;
-    } while (x < 0);
+    drawCommand(memory, &(DrawCommand){ DrawCircleBorder, .ellipse = { xm, ym, radius, radius, color } }, NULL, 0);
+}
+
+static void drawEllipse(Canvas* canvas, s32 xm, s32 ym, s32 a, s32 b, u8 color, bool fill)
+{
+    if (a < 0 || b < 0 || EARLY_CLIP(xm - a, ym - b, a * 2 + 1, b * 2 + 1)) return;
+
+    bool inside = isShapeInsideClip(canvas, xm, ym, a, b);
+
+    // midpoint ellipse by quadrant, x only grows so the first point
+    // of every row is its widest
+    s64 x = -a, y = 0, row = -1;
+    s64 e2 = b, dx = (1 + 2 * x) * e2 * e2;
+    s64 dy = x * x, err = dx + dy;
+
+    do
+    {
+        if (fill)
+        {
+            if (y != row)
+            {
+                drawCircleRows(canvas, xm, ym, (s32)y, (s32)-x, color, inside);
+                row = y;
+            }
+        }
+        else
+        {
+            drawShapePixel(canvas, xm - (s32)x, ym + (s32)y, color, inside);
+            drawShapePixel(canvas, xm + (s32)x, ym + (s32)y, color, inside);
+            drawShapePixel(canvas, xm + (s32)x, ym - (s32)y, color, inside);
+            drawShapePixel(canvas, xm - (s32)x, ym - (s32)y, color, inside);
+        }
+
+        e2 = 2 * err;
+        if (e2 >= dx) { x++; err += dx += 2 * (s64)b * b; }
+        if (e2 <= dy) { y++; err += dy += 2 * (s64)a * a; }
+    } while (x <= 0);
+
+    // flat ellipses stop early, finish the tips
+    while (y++ < b)
+    {
+        drawShapePixel(canvas, xm, ym + (s32)y, color, inside);
+        drawShapePixel(canvas, xm, ym - (s32)y, color, inside);
+    }
+}
+
+void tic_api_elli(tic_mem* memory, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+    drawCommand(memory, &(DrawCommand){ DrawEllipse, .ellipse = { x, y, a, b, color } }, NULL, 0);
 }
 
-typedef void(*linePixelFunc)(tic_mem* memory, s32 x, s32 y, u8 color);
-static void ticLine(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color, linePixelFunc func)
+void tic_api_ellib(tic_mem* memory, s32 x, s32 y, s32 a, s32 b, u8 color)
+{
+    drawCommand(memory, &(DrawCommand){ DrawEllipseBorder, .ellipse = { x, y, a, b, color } }, NULL, 0);
+}
+static void ticLine(SidesBuffer* sides, s32 x0, s32 y0, s32 x1, s32 y1)
 {
     if (y0 > y1)
     {
@@ -537,7 +838,7 @@ static void ticLine(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color, l
 
     for (;;)
     {
-        func(memory, x0, y0, color);
+        setSidePixel(sides, x0, y0);
         if (x0 == x1 && y0 == y1) break;
         e2 = err;
         if (e2 > -dx) { err -= dy; x0 += sx; }
@@ -545,206 +846,529 @@ static void ticLine(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color, l
     }
 }
 
-static void triPixelFunc(tic_mem* memory, s32 x, s32 y, u8 color)
+static void drawTriangle(Canvas* canvas, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
 {
-    setSidePixel(x, y);
-}
+    tic_core* core = canvas->core;
+    SidesBuffer sides;
 
-void tic_api_tri(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
-{
-    tic_core* core = (tic_core*)memory;
-
-    initSidesBuffer();
+    initSidesBuffer(&sides);
 
-    ticLine(memory, x1, y1, x2, y2, color, triPixelFunc);
-    ticLine(memory, x2, y2, x3, y3, color, triPixelFunc);
-    ticLine(memory, x3, y3, x1, y1, color, triPixelFunc);
+    ticLine(&sides, x1, y1, x2, y2);
+    ticLine(&sides, x2, y2, x3, y3);
+    ticLine(&sides, x3, y3, x1, y1);
 
     u8 final_color = mapColor(&core->memory, color);
-    s32 yt = MAX(core->state.clip.t, MIN(y1, MIN(y2, y3)));
-    s32 yb = MIN(core->state.clip.b, MAX(y1, MAX(y2, y3)) + 1);
+    s32 yt = MAX(canvas->clip.t, MIN(y1, MIN(y2, y3)));
+    s32 yb = MIN(canvas->clip.b, MAX(y1, MAX(y2, y3)) + 1);
 
     for (s32 y = yt; y < yb; y++) {
-        s32 xl = MAX(SidesBuffer.Left[y], core->state.clip.l);
-        s32 xr = MIN(SidesBuffer.Right[y] + 1, core->state.clip.r);
+        s32 xl = MAX(sides.Left[y], canvas->clip.l);
+        s32 xr = MIN(sides.Right[y] + 1, canvas->clip.r);
         core->state.drawhline(&core->memory, xl, xr, y, final_color);
     }
 }
 
+void tic_api_tri(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
+{
+    drawCommand(memory, &(DrawCommand){ DrawTriangle, .tri = { x1, y1, x2, y2, x3, y3, color } }, NULL, 0);
+}
+
+
+// 16.16 fixed point triangle rasterizer
+// pixel centers are sampled at (x + .5, y + .5) with a top-left fill rule,
+// so triangles sharing an edge never overdraw or leave gaps between them
+#define FIX_ONE (1 << 16)
+#define FIX_HALF (1 << 15)
+#define FIX_CEIL(v) ((s32)(((s64)(v) - FIX_HALF + FIX_ONE - 1) >> 16))
+
+typedef struct
+{
+    s32 x, y;
+    s32 z, u, v;
+    float w;    // 1/z for perspective correct texturing
+} RasterVert;
+
+typedef struct
+{
+    s32 top, bottom;
+    s64 x, dxdy;
+} RasterEdge;
+
+typedef struct
+{
+    s64 base;
+    s64 dx, dy;
+} RasterGrad;
+
+typedef struct
+{
+    float base;
+    float dx, dy;
+} RasterGradF;
 
 typedef struct
 {
-    float x, y, u, v;
-} TexVert;
+    Canvas* canvas;
+    u8 color;
+    u8 mapping[TIC_PALETTE_SIZE];
+    tic_tilesheet sheet;
+    bool textured;
+    bool use_map;
+    bool depth;
+    bool perspective;
+} RasterState;
+
+typedef struct
+{
+    s32 index;
+    tic_tileptr ptr;
+} RasterTile;
+
+static inline s32 floatToFix(float value)
+{
+    return (s32)(CLAMP(value, -32768.0f, 32767.0f) * FIX_ONE);
+}
+
+static void initRasterEdge(RasterEdge* edge, const RasterVert* a, const RasterVert* b)
+{
+    edge->top = FIX_CEIL(a->y);
+    edge->bottom = FIX_CEIL(b->y);
+
+    if (edge->bottom > edge->top)
+    {
+        edge->dxdy = ((s64)b->x - a->x) * FIX_ONE / ((s64)b->y - a->y);
+        edge->x = a->x + ((edge->dxdy * ((s64)edge->top * FIX_ONE + FIX_HALF - a->y)) >> 16);
+    }
+    else edge->x = edge->dxdy = 0;
+}
+
+static inline s32 rasterEdgeX(const RasterEdge* edge, s32 y)
+{
+    return FIX_CEIL(edge->x + edge->dxdy * (y - edge->top));
+}
+
+// value at pixel (x,y) is base + dx * x + dy * y
+static void initRasterGrad(RasterGrad* grad, const RasterVert* v0, float dadx, float dady, s32 a0)
+{
+    grad->dx = (s64)(dadx * FIX_ONE);
+    grad->dy = (s64)(dady * FIX_ONE);
+    grad->base = a0 + ((grad->dx * (FIX_HALF - v0->x) + grad->dy * (FIX_HALF - v0->y)) >> 16);
+}
+
+static inline s32 rasterGradAt(const RasterGrad* grad, s32 x, s32 y)
+{
+    return (s32)(grad->base + grad->dx * x + grad->dy * y);
+}
+
+static inline float rasterGradAtF(const RasterGradF* grad, s32 x, s32 y)
+{
+    return grad->base + grad->dx * x + grad->dy * y;
+}
+
+// sorts vertices top to bottom, equal rows are ordered by index
+static void sortRasterVerts(const RasterVert* vert, const s32 index[3], s32 order[3])
+{
+    order[0] = 0, order[1] = 1, order[2] = 2;
+
+#define VERT_ABOVE(a, b) (vert[a].y < vert[b].y || (vert[a].y == vert[b].y && index[a] < index[b]))
+    if (VERT_ABOVE(order[1], order[0])) SWAP(order[0], order[1], s32);
+    if (VERT_ABOVE(order[2], order[1])) SWAP(order[1], order[2], s32);
+    if (VERT_ABOVE(order[1], order[0])) SWAP(order[0], order[1], s32);
+#undef VERT_ABOVE
+}
+
+static inline u8 getRasterTexel(const RasterState* state, RasterTile* tile, s32 u, s32 v)
+{
+    if (state->use_map)
+    {
+        enum { MapWidth = TIC_MAP_WIDTH * TIC_SPRITESIZE, MapHeight = TIC_MAP_HEIGHT * TIC_SPRITESIZE };
+        s32 iu = (u >> 16) % MapWidth;
+        s32 iv = (v >> 16) % MapHeight;
+
+        if (iu < 0) iu += MapWidth;
+        if (iv < 0) iv += MapHeight;
+
+        // neighbour texels mostly come from the same tile
+        s32 index = (iv >> 3) * TIC_MAP_WIDTH + (iu >> 3);
+        if (index != tile->index)
+        {
+            tile->index = index;
+            tile->ptr = tic_tilesheet_gettile(&state->sheet, state->canvas->core->memory.ram.map.data[index], true);
+        }
+
+        return state->mapping[tic_tilesheet_gettilepix(&tile->ptr, iu & 7, iv & 7)];
+    }
+    else
+    {
+        enum { SheetWidth = TIC_SPRITESHEET_SIZE, SheetHeight = TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS };
+        s32 iu = (u >> 16) & (SheetWidth - 1);
+        s32 iv = (v >> 16) & (SheetHeight - 1);
+
+        return state->mapping[tic_tilesheet_getpix(&state->sheet, iu, iv)];
+    }
+}
+
+static void drawRasterSpan(const RasterState* state, const RasterGrad grads[3], RasterTile* tile, s32 xl, s32 xr, s32 y)
+{
+    tic_core* core = state->canvas->core;
+
+    if (!state->textured && !state->depth)
+    {
+        core->state.drawhline(&core->memory, xl, xr, y, state->color);
+        return;
+    }
+
+    s32 z = rasterGradAt(&grads[0], xl, y);
+    s32 u = rasterGradAt(&grads[1], xl, y);
+    s32 v = rasterGradAt(&grads[2], xl, y);
+    s32 dzdx = (s32)grads[0].dx;
+    s32 dudx = (s32)grads[1].dx;
+    s32 dvdx = (s32)grads[2].dx;
+
+    s32* depth = core->depth + y * TIC80_WIDTH;
+
+    for (s32 x = xl; x < xr; x++, z += dzdx, u += dudx, v += dvdx)
+    {
+        if (state->depth && z >= depth[x])
+            continue;
+
+        u8 color = state->textured ? getRasterTexel(state, tile, u, v) : state->color;
 
+        if (color == TRANSPARENT_COLOR)
+            continue;
 
-static void ticTexLine(tic_mem* memory, TexVert* v0, TexVert* v1)
+        if (state->depth)
+            depth[x] = z;
+
+        core->state.setpix(&core->memory, x, y, color);
+    }
+}
+
+// u/z, v/z and 1/z are linear in screen space, u and v are recovered per pixel
+static void drawRasterSpanPerspective(const RasterState* state, const RasterGradF grads[3], RasterTile* tile, s32 xl, s32 xr, s32 y)
 {
-    TexVert* top = v0;
-    TexVert* bot = v1;
+    tic_core* core = state->canvas->core;
 
-    if (bot->y < top->y)
+    float w = rasterGradAtF(&grads[0], xl, y);
+    float uw = rasterGradAtF(&grads[1], xl, y);
+    float vw = rasterGradAtF(&grads[2], xl, y);
+
+    for (s32 x = xl; x < xr; x++, w += grads[0].dx, uw += grads[1].dx, vw += grads[2].dx)
     {
-        top = v1;
-        bot = v0;
+        float z = 1.0f / w;
+        u8 color = getRasterTexel(state, tile, floatToFix(uw * z), floatToFix(vw * z));
+
+        if (color != TRANSPARENT_COLOR)
+            core->state.setpix(&core->memory, x, y, color);
     }
+}
 
-    float dy = bot->y - top->y;
-    float step_x = (bot->x - top->x);
-    float step_u = (bot->u - top->u);
-    float step_v = (bot->v - top->v);
+// vertices are sorted by y, edges go top->middle, middle->bottom and top->bottom
+static void drawRasterTriangle(const RasterState* state, const RasterVert* v0, const RasterVert* v1, const RasterVert* v2,
+    const RasterEdge* e01, const RasterEdge* e12, const RasterEdge* e02)
+{
+    const tic_clip_data* clip = &state->canvas->clip;
+
+    float x01 = (float)(v1->x - v0->x), y01 = (float)(v1->y - v0->y);
+    float x02 = (float)(v2->x - v0->x), y02 = (float)(v2->y - v0->y);
+
+    float denom = x01 * y02 - x02 * y01;
+    if (denom == 0.0f)
+        return;
+
+    float id = 1.0f / denom;
 
-    if ((s32)dy != 0)
+#define RASTER_DADX(a0, a1, a2) (((a1) - (a0)) * y02 - ((a2) - (a0)) * y01) * id
+#define RASTER_DADY(a0, a1, a2) (((a2) - (a0)) * x01 - ((a1) - (a0)) * x02) * id
+
+    RasterGrad grads[3] = {0};
+    RasterGradF gradsf[3];
+
+    if (state->perspective)
     {
-        step_x /= dy;
-        step_u /= dy;
-        step_v /= dy;
+        float px = (FIX_HALF - v0->x) / (float)FIX_ONE;
+        float py = (FIX_HALF - v0->y) / (float)FIX_ONE;
+
+        float a[3][3] =
+        {
+            {v0->w, v1->w, v2->w},
+            {v0->w * v0->u / FIX_ONE, v1->w * v1->u / FIX_ONE, v2->w * v2->u / FIX_ONE},
+            {v0->w * v0->v / FIX_ONE, v1->w * v1->v / FIX_ONE, v2->w * v2->v / FIX_ONE},
+        };
+
+        for (s32 i = 0; i < COUNT_OF(gradsf); i++)
+        {
+            RasterGradF* grad = &gradsf[i];
+
+            // gradients are per 16.16 unit, scale them to pixels
+            grad->dx = RASTER_DADX(a[i][0], a[i][1], a[i][2]) * FIX_ONE;
+            grad->dy = RASTER_DADY(a[i][0], a[i][1], a[i][2]) * FIX_ONE;
+            grad->base = a[i][0] + grad->dx * px + grad->dy * py;
+        }
+    }
+    else if (state->textured || state->depth)
+    {
+        initRasterGrad(&grads[0], v0, RASTER_DADX((float)v0->z, v1->z, v2->z), RASTER_DADY((float)v0->z, v1->z, v2->z), v0->z);
+        initRasterGrad(&grads[1], v0, RASTER_DADX((float)v0->u, v1->u, v2->u), RASTER_DADY((float)v0->u, v1->u, v2->u), v0->u);
+        initRasterGrad(&grads[2], v0, RASTER_DADX((float)v0->v, v1->v, v2->v), RASTER_DADY((float)v0->v, v1->v, v2->v), v0->v);
     }
 
-    float x = top->x;
-    float y = top->y;
-    float u = top->u;
-    float v = top->v;
+#undef RASTER_DADX
+#undef RASTER_DADY
+
+    // middle vertex is on the left side when the long edge passes to its right
+    bool midLeft = denom < 0.0f;
+
+    s32 yt = MAX(e02->top, clip->t);
+    s32 yb = MIN(e02->bottom, clip->b);
+
+    RasterTile tile = {.index = -1};
 
-    if (y < .0f)
+    for (s32 y = yt; y < yb; y++)
     {
-        y = .0f - y;
+        const RasterEdge* shortEdge = y < e01->bottom ? e01 : e12;
+        const RasterEdge* left = midLeft ? shortEdge : e02;
+        const RasterEdge* right = midLeft ? e02 : shortEdge;
 
-        x += step_x * y;
-        u += step_u * y;
-        v += step_v * y;
+        s32 xl = MAX(rasterEdgeX(left, y), clip->l);
+        s32 xr = MIN(rasterEdgeX(right, y), clip->r);
 
-        y = .0f;
+        if (xl < xr)
+        {
+            if (state->perspective)
+                drawRasterSpanPerspective(state, gradsf, &tile, xl, xr, y);
+            else
+                drawRasterSpan(state, grads, &tile, xl, xr, y);
+        }
     }
+}
 
-    s32 botY = (s32)bot->y;
-    if (botY > TIC80_HEIGHT)
-        botY = TIC80_HEIGHT;
+static void drawTexturedTriangle(Canvas* canvas, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, const u8* colors, s32 count, float z1, float z2, float z3, bool perspective)
+{
+    tic_mem* memory = &canvas->core->memory;
+
+    // perspective needs every vertex in front of the camera
+    if (perspective && (z1 <= 0.0f || z2 <= 0.0f || z3 <= 0.0f))
+        perspective = false;
 
-    for (; y < botY; ++y)
+    RasterState state =
     {
-        setSideTexPixel((s32)x, (s32)y, u, v);
-        x += step_x;
-        u += step_u;
-        v += step_v;
+        .canvas = canvas,
+        .sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment),
+        .textured = true,
+        .use_map = use_map,
+        .perspective = perspective,
+    };
+
+    getPalette(memory, state.mapping, colors, count);
+
+    const RasterVert vert[] =
+    {
+        {floatToFix(x1), floatToFix(y1), 0, floatToFix(u1), floatToFix(v1), perspective ? 1.0f / z1 : 1.0f},
+        {floatToFix(x2), floatToFix(y2), 0, floatToFix(u2), floatToFix(v2), perspective ? 1.0f / z2 : 1.0f},
+        {floatToFix(x3), floatToFix(y3), 0, floatToFix(u3), floatToFix(v3), perspective ? 1.0f / z3 : 1.0f},
+    };
+
+    static const s32 Index[] = {0, 1, 2};
+    s32 order[3];
+    sortRasterVerts(vert, Index, order);
+
+    const RasterVert* top = &vert[order[0]];
+    const RasterVert* mid = &vert[order[1]];
+    const RasterVert* bot = &vert[order[2]];
+
+    RasterEdge e01, e12, e02;
+    initRasterEdge(&e01, top, mid);
+    initRasterEdge(&e12, mid, bot);
+    initRasterEdge(&e02, top, bot);
+
+    drawRasterTriangle(&state, top, mid, bot, &e01, &e12, &e02);
+}
+
+void tic_api_textri(tic_mem* memory, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count, float z1, float z2, float z3, bool perspective)
+{
+    count = MAX(count, 0);
+    drawCommand(memory, &(DrawCommand){ DrawTexturedTriangle, .textri = { x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, z1, z2, z3, count, use_map, perspective } }, colors, count);
+}
+
+static inline s32 peek16(const u8* ptr)
+{
+    return (s16)(ptr[0] | ptr[1] << 8);
+}
+
+static bool loadMeshVert(const tic_mem* memory, RasterVert* vert, s32 index, s32 vertices, s32 uvs)
+{
+    const u8* ram = (const u8*)&memory->ram;
+
+    if (index * TIC_MESH_VERTEX_SIZE + TIC_MESH_VERTEX_SIZE > (s32)sizeof(tic_ram) - vertices)
+        return false;
+
+    const u8* src = ram + vertices + index * TIC_MESH_VERTEX_SIZE;
+    vert->x = peek16(src) * FIX_ONE;
+    vert->y = peek16(src + 2) * FIX_ONE;
+    vert->z = peek16(src + 4) * FIX_ONE;
+    vert->u = vert->v = 0;
+    vert->w = 1.0f;
+
+    if (uvs >= 0)
+    {
+        if (index * TIC_MESH_UV_SIZE + TIC_MESH_UV_SIZE > (s32)sizeof(tic_ram) - uvs)
+            return false;
+
+        const u8* uv = ram + uvs + index * TIC_MESH_UV_SIZE;
+        vert->u = peek16(uv) * FIX_ONE;
+        vert->v = peek16(uv + 2) * FIX_ONE;
     }
+
+    return true;
 }
 
-static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
+static void drawMesh(Canvas* canvas, s32 vertices, s32 indices, s32 count, u8 color, u8 flags, s32 uvs, bool use_map, const u8* colors, s32 colorCount)
 {
+    tic_core* core = canvas->core;
     tic_mem* memory = &core->memory;
-    u8* mapping = getPalette(memory, colors, count);
-    TexVert V0, V1, V2;
 
-    const u8* map = memory->ram.map.data;
-    tic_tilesheet sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
+    enum { EdgeCacheSize = 256 };
+
+    // only the rows of the canvas, the other bands clear theirs
+    if (flags & TIC_MESH_CLEAR_DEPTH)
+        memset(core->depth + canvas->top * TIC80_WIDTH, 0x7f, (canvas->bottom - canvas->top) * TIC80_WIDTH * sizeof *core->depth);
 
-    V0.x = x1;  V0.y = y1;  V0.u = u1;  V0.v = v1;
-    V1.x = x2;  V1.y = y2;  V1.u = u2;  V1.v = v2;
-    V2.x = x3;  V2.y = y3;  V2.u = u3;  V2.v = v3;
+    count = MIN(count, (s32)(sizeof(tic_ram) - indices) / TIC_MESH_TRIANGLE_SIZE);
 
-    //  calculate the slope of the surface 
-    //  use floats here 
-    float denom = (V0.x - V2.x) * (V1.y - V2.y) - (V1.x - V2.x) * (V0.y - V2.y);
-    if (denom == 0.0)
+    RasterState state =
     {
-        return;
+        .canvas = canvas,
+        .color = mapColor(memory, color),
+        .textured = uvs >= 0,
+        .use_map = use_map,
+        .depth = flags & TIC_MESH_DEPTH,
+    };
+
+    if (state.textured)
+    {
+        getPalette(memory, state.mapping, colors, colorCount);
+        state.sheet = getTileSheetFromSegment(memory, memory->ram.vram.blit.segment);
     }
-    float id = 1.0f / denom;
-    float dudx, dvdx;
-    //  this is the UV slope across the surface
-    dudx = ((V0.u - V2.u) * (V1.y - V2.y) - (V1.u - V2.u) * (V0.y - V2.y)) * id;
-    dvdx = ((V0.v - V2.v) * (V1.y - V2.y) - (V1.v - V2.v) * (V0.y - V2.y)) * id;
-    //  convert to fixed
-    s32 dudxs = (s32)(dudx * 65536.0f);
-    s32 dvdxs = (s32)(dvdx * 65536.0f);
-    //  fill the buffer 
-    initSidesBuffer();
-    //  parse each line and decide where in the buffer to store them ( left or right ) 
-    ticTexLine(memory, &V0, &V1);
-    ticTexLine(memory, &V1, &V2);
-    ticTexLine(memory, &V2, &V0);
-
-    for (s32 y = 0; y < TIC80_HEIGHT; y++)
-    {
-        //  if it's backwards skip it
-        s32 width = SidesBuffer.Right[y] - SidesBuffer.Left[y];
-        //  if it's off top or bottom , skip this line
-        if ((y < core->state.clip.t) || (y > core->state.clip.b))
-            width = 0;
-        if (width > 0)
+
+    // edges shared by neighbour triangles are set up once
+    struct { u32 key; RasterEdge edge; } cache[EdgeCacheSize];
+    for (s32 i = 0; i < EdgeCacheSize; i++)
+        cache[i].key = UINT32_MAX;
+
+    for (s32 t = 0; t < count; t++)
+    {
+        const u8* tri = (const u8*)&memory->ram + indices + t * TIC_MESH_TRIANGLE_SIZE;
+        s32 index[3];
+        RasterVert vert[3];
+
+        bool valid = true;
+        for (s32 i = 0; i < 3 && valid; i++)
         {
-            s32 u = SidesBuffer.ULeft[y];
-            s32 v = SidesBuffer.VLeft[y];
-            s32 left = SidesBuffer.Left[y];
-            s32 right = SidesBuffer.Right[y];
-            //  check right edge, and CLAMP it
-            if (right > core->state.clip.r)
-                right = core->state.clip.r;
-            //  check left edge and offset UV's if we are off the left 
-            if (left < core->state.clip.l)
-            {
-                s32 dist = core->state.clip.l - SidesBuffer.Left[y];
-                u += dudxs * dist;
-                v += dvdxs * dist;
-                left = core->state.clip.l;
-            }
-            //  are we drawing from the map . ok then at least check before the inner loop
-            if (use_map == true)
-            {
-                for (s32 x = left; x < right; ++x)
-                {
-                    enum { MapWidth = TIC_MAP_WIDTH * TIC_SPRITESIZE, MapHeight = TIC_MAP_HEIGHT * TIC_SPRITESIZE };
-                    s32 iu = (u >> 16) % MapWidth;
-                    s32 iv = (v >> 16) % MapHeight;
+            index[i] = (u16)peek16(tri + i * 2);
+            valid = loadMeshVert(memory, &vert[i], index[i], vertices, uvs);
+        }
 
-                    while (iu < 0) iu += MapWidth;
-                    while (iv < 0) iv += MapHeight;
+        if (!valid) continue;
 
-                    u8 tileindex = map[(iv >> 3) * TIC_MAP_WIDTH + (iu >> 3)];
-                    tic_tileptr tile = tic_tilesheet_gettile(&sheet, tileindex, true);
+        if (flags & TIC_MESH_CULL)
+        {
+            double area = (double)(vert[1].x - vert[0].x) * (vert[2].y - vert[0].y)
+                - (double)(vert[2].x - vert[0].x) * (vert[1].y - vert[0].y);
 
-                    u8 color = mapping[tic_tilesheet_gettilepix(&tile, iu & 7, iv & 7)];
-                    if (color != TRANSPARENT_COLOR)
-                        setPixel(core, x, y, color);
-                    u += dudxs;
-                    v += dvdxs;
-                }
-            }
-            else
+            if (area <= 0.0)
+                continue;
+        }
+
+        s32 order[3];
+        sortRasterVerts(vert, index, order);
+
+        static const s32 Pairs[3][2] = {{0, 1}, {1, 2}, {0, 2}};
+        RasterEdge edges[3];
+
+        for (s32 e = 0; e < 3; e++)
+        {
+            s32 a = order[Pairs[e][0]];
+            s32 b = order[Pairs[e][1]];
+            u32 key = (u32)index[a] << 16 | index[b];
+            s32 slot = (index[a] * 31 + index[b]) & (EdgeCacheSize - 1);
+
+            if (cache[slot].key != key)
             {
-                //  direct from tile ram 
-                for (s32 x = left; x < right; ++x)
-                {
-                    enum { SheetWidth = TIC_SPRITESHEET_SIZE, SheetHeight = TIC_SPRITESHEET_SIZE * TIC_SPRITE_BANKS };
-                    s32 iu = (u >> 16) & (SheetWidth - 1);
-                    s32 iv = (v >> 16) & (SheetHeight - 1);
-
-                    u8 color = mapping[tic_tilesheet_getpix(&sheet, iu, iv)];
-                    if (color != TRANSPARENT_COLOR)
-                        setPixel(core, x, y, color);
-                    u += dudxs;
-                    v += dvdxs;
-                }
+                cache[slot].key = key;
+                initRasterEdge(&cache[slot].edge, &vert[a], &vert[b]);
             }
+
+            edges[e] = cache[slot].edge;
         }
+
+        drawRasterTriangle(&state, &vert[order[0]], &vert[order[1]], &vert[order[2]], &edges[0], &edges[1], &edges[2]);
     }
 }
 
-void tic_api_textri(tic_mem* memory, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
+void tic_api_mesh(tic_mem* memory, s32 vertices, s32 indices, s32 count, u8 color, u8 flags, s32 uvs, bool use_map, u8* colors, s32 colorCount)
 {
-    drawTexturedTriangle((tic_core*)memory, x1, y1, x2, y2, x3, y3, u1, v1, u2, v2, u3, v3, use_map, colors, count);
+    if (vertices < 0 || vertices >= sizeof(tic_ram)
+        || indices < 0 || indices >= sizeof(tic_ram)
+        || uvs >= (s32)sizeof(tic_ram))
+        return;
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    // vertex data read from the screen memory has to see everything drawn
+    // before it, and the bands would write it while others read it
+    enum { Screen = sizeof(memory->ram.vram.screen) };
+    bool immediate = vertices < Screen || indices < Screen || (uvs >= 0 && uvs < Screen);
+
+    if (immediate)
+        tic_deferred_immediate(memory, true);
+#endif
+
+    colorCount = MAX(colorCount, 0);
+    drawCommand(memory, &(DrawCommand){ DrawMesh, .mesh = { vertices, indices, count, uvs, colorCount, color, flags, use_map } }, colors, colorCount);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    if (immediate)
+        tic_deferred_immediate(memory, false);
+    else
+    {
+        // the vertex data is read when the mesh is replayed
+        tic_deferred_touch(memory, vertices, sizeof(tic_ram) - vertices);
+        tic_deferred_touch(memory, indices, sizeof(tic_ram) - indices);
+
+        if (uvs >= 0)
+            tic_deferred_touch(memory, uvs, sizeof(tic_ram) - uvs);
+    }
+#endif
 }
 
 void tic_api_map(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, s32 sx, s32 sy, u8* colors, s32 count, s32 scale, RemapFunc remap, void* data)
 {
-    drawMap((tic_core*)memory, &memory->ram.map, x, y, width, height, sx, sy, colors, count, scale, remap, data);
+    if (remap)
+    {
+        // the callback runs script code, it can't be replayed on another thread
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+        tic_deferred_immediate(memory, true);
+#endif
+
+        Canvas canvas = getCanvas((tic_core*)memory);
+        drawMap(&canvas, &memory->ram.map, x, y, width, height, sx, sy, colors, count, scale, remap, data);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+        tic_deferred_immediate(memory, false);
+#endif
+        return;
+    }
+
+    count = MAX(count, 0);
+    drawCommand(memory, &(DrawCommand){ DrawMap, .map = { x, y, width, height, sx, sy, count, scale } }, colors, count);
 }
 
 void tic_api_mset(tic_mem* memory, s32 x, s32 y, u8 value)
 {
     if (x < 0 || x >= TIC_MAP_WIDTH || y < 0 || y >= TIC_MAP_HEIGHT) return;
 
+    FLUSH_DEFERRED(memory, offsetof(tic_ram, map) + y * TIC_MAP_WIDTH + x, 1);
+
     tic_map* src = &memory->ram.map;
     *(src->data + y * TIC_MAP_WIDTH + x) = value;
 }
@@ -757,12 +1381,248 @@ u8 tic_api_mget(tic_mem* memory, s32 x, s32 y)
     return *(src->data + y * TIC_MAP_WIDTH + x);
 }
 
-static inline void setLinePixel(tic_mem* tic, s32 x, s32 y, u8 color)
+// narrows [*kmin,*kmax] to the steps whose minor offset floor((2*k*m + M - 1) / 2M)
+// stays inside [jlo,jhi], the same pixels ticLine visits
+static void clipLineMinor(s64 M, s64 m, s64 jlo, s64 jhi, s64* kmin, s64* kmax)
 {
-    setPixel((tic_core*)tic, x, y, color);
+    if (jlo > 0)
+        *kmin = MAX(*kmin, (2 * jlo * M - M + 1 + 2 * m - 1) / (2 * m));
+
+    if (jhi < 0)
+        *kmax = -1;
+    else if (jhi < m)
+        *kmax = MIN(*kmax, (2 * jhi * M + M) / (2 * m));
+}
+
+static void drawLine(Canvas* canvas, s32 x0, s32 y0, s32 x1, s32 y1, u8 color)
+{
+    if (y0 > y1)
+    {
+        SWAP(x0, x1, s32);
+        SWAP(y0, y1, s32);
+    }
+
+    const tic_clip_data* clip = &canvas->clip;
+
+    // trivial reject, both ends are outside on the same side
+    if (MAX(x0, x1) < clip->l || MIN(x0, x1) >= clip->r || y1 < clip->t || y0 >= clip->b)
+        return;
+
+    if (y0 == y1)
+    {
+        drawHLine(canvas, MIN(x0, x1), y0, abs(x1 - x0) + 1, color);
+        return;
+    }
+
+    if (x0 == x1)
+    {
+        drawVLine(canvas, x0, y0, y1 - y0 + 1, color);
+        return;
+    }
+
+    s64 dx = llabs((s64)x1 - x0), dy = (s64)y1 - y0;
+    s32 sx = x0 < x1 ? 1 : -1;
+    bool xmajor = dx > dy;
+    s64 M = xmajor ? dx : dy;
+    s64 m = xmajor ? dy : dx;
+
+    // x range as offsets along the line direction
+    s64 xlo = sx > 0 ? (s64)clip->l - x0 : (s64)x0 - (clip->r - 1);
+    s64 xhi = sx > 0 ? (s64)clip->r - 1 - x0 : (s64)x0 - clip->l;
+    s64 ylo = (s64)clip->t - y0;
+    s64 yhi = (s64)clip->b - 1 - y0;
+
+    s64 kmin = MAX(0, xmajor ? xlo : ylo);
+    s64 kmax = MIN(M, xmajor ? xhi : yhi);
+
+    clipLineMinor(M, m, xmajor ? ylo : xlo, xmajor ? yhi : xhi, &kmin, &kmax);
+
+    if (kmin > kmax)
+        return;
+
+    s64 n = 2 * kmin * m + M - 1;
+    s64 j = n / (2 * M);
+    s64 rem = n - j * 2 * M;
+
+    s32 x = x0 + sx * (s32)(xmajor ? kmin : j);
+    s32 y = y0 + (s32)(xmajor ? j : kmin);
+    s32 count = (s32)(kmax - kmin);
+
+    tic_core* core = canvas->core;
+    void (*setpix)(tic_mem*, s32, s32, u8) = core->state.setpix;
+
+    if (dx == dy)
+    {
+        for (s32 i = 0; i <= count; i++, x += sx, y++)
+            setpix(&core->memory, x, y, color);
+    }
+    else if (xmajor)
+    {
+        for (s32 i = 0; i <= count; i++, x += sx)
+        {
+            setpix(&core->memory, x, y, color);
+            if ((rem += 2 * m) >= 2 * M) rem -= 2 * M, y++;
+        }
+    }
+    else
+    {
+        for (s32 i = 0; i <= count; i++, y++)
+        {
+            setpix(&core->memory, x, y, color);
+            if ((rem += 2 * m) >= 2 * M) rem -= 2 * M, x += sx;
+        }
+    }
 }
 
 void tic_api_line(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color)
 {
-    ticLine(memory, x0, y0, x1, y1, mapColor(memory, color), setLinePixel);
+    drawCommand(memory, &(DrawCommand){ DrawLine, .line = { x0, y0, x1, y1, color } }, NULL, 0);
+}
+
+static s32 runCommand(Canvas* canvas, const DrawCommand* command, const void* data)
+{
+    tic_mem* memory = &canvas->core->memory;
+
+    switch (command->type)
+    {
+    case DrawCls:
+        clearScreen(canvas, &command->clip, command->cls.color);
+        break;
+    case DrawPix:
+        setPixel(canvas, command->pix.x, command->pix.y, mapColor(memory, command->pix.color));
+        break;
+    case DrawLine:
+        {
+            const LineArgs* a = &command->line;
+            drawLine(canvas, a->x0, a->y0, a->x1, a->y1, mapColor(memory, a->color));
+        }
+        break;
+    case DrawRect:
+        {
+            const RectArgs* a = &command->rect;
+            drawRect(canvas, a->x, a->y, a->w, a->h, mapColor(memory, a->color));
+        }
+        break;
+    case DrawRectBorder:
+        {
+            const RectArgs* a = &command->rect;
+            drawRectBorder(canvas, a->x, a->y, a->w, a->h, mapColor(memory, a->color));
+        }
+        break;
+    case DrawCircle:
+        drawCircle(canvas, command->ellipse.x, command->ellipse.y, command->ellipse.a, command->ellipse.color);
+        break;
+    case DrawCircleBorder:
+        drawCircleBorder(canvas, command->ellipse.x, command->ellipse.y, command->ellipse.a, command->ellipse.color);
+        break;
+    case DrawEllipse:
+    case DrawEllipseBorder:
+        {
+            const EllipseArgs* a = &command->ellipse;
+            drawEllipse(canvas, a->x, a->y, a->a, a->b, mapColor(memory, a->color), command->type == DrawEllipse);
+        }
+        break;
+    case DrawTriangle:
+        {
+            const TriangleArgs* a = &command->tri;
+            drawTriangle(canvas, a->x1, a->y1, a->x2, a->y2, a->x3, a->y3, a->color);
+        }
+        break;
+    case DrawTexturedTriangle:
+        {
+            const TexturedTriangleArgs* a = &command->textri;
+            drawTexturedTriangle(canvas, a->x1, a->y1, a->x2, a->y2, a->x3, a->y3, a->u1, a->v1, a->u2, a->v2, a->u3, a->v3,
+                a->use_map, data, a->count, a->z1, a->z2, a->z3, a->perspective);
+        }
+        break;
+    case DrawMesh:
+        {
+            const MeshArgs* a = &command->mesh;
+            drawMesh(canvas, a->vertices, a->indices, a->count, a->color, a->flags, a->uvs, a->use_map, data, a->colorCount);
+        }
+        break;
+    case DrawSprite:
+        {
+            const SpriteArgs* a = &command->spr;
+            drawSprite(canvas, a->index, a->x, a->y, a->w, a->h, data, a->count, a->scale, a->flip, a->rotate);
+        }
+        break;
+    case DrawSprites:
+        drawSprites(canvas, data, command->sprs.count);
+        break;
+    case DrawMap:
+        {
+            const MapArgs* a = &command->map;
+            drawMap(canvas, &memory->ram.map, a->x, a->y, a->w, a->h, a->sx, a->sy, data, a->count, a->scale, NULL, NULL);
+        }
+        break;
+    case DrawPrint:
+        {
+            const TextArgs* a = &command->text;
+            return drawPrint(canvas, data, a->x, a->y, a->color, a->fixed, a->scale, a->alt);
+        }
+    case DrawFont:
+        {
+            const TextArgs* a = &command->text;
+            return drawFont(canvas, data, a->x, a->y, a->color, a->w, a->h, a->fixed, a->scale, a->alt);
+        }
+    }
+
+    return 0;
+}
+
+// draws the call right away or, in TIC() with deferred drawing, records it
+// with the data it points to
+static s32 drawCommand(tic_mem* memory, DrawCommand* command, const void* data, s32 size)
+{
+    tic_core* core = (tic_core*)memory;
+    Canvas canvas = getCanvas(core);
+
+    command->clip = core->state.clip;
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    enum { Align = sizeof(u64) };
+
+    command->size = (sizeof(DrawCommand) + size + Align - 1) & ~(Align - 1);
+
+    DrawCommand* record = tic_deferred_alloc(memory, command->size);
+
+    if (record)
+    {
+        *record = *command;
+
+        if (size)
+            memcpy(record + 1, data, size);
+
+        if (command->type != DrawPrint && command->type != DrawFont)
+            return 0;
+
+        // text returns its width, measure it without drawing anything
+        canvas.clip = (tic_clip_data){ 0, 0, 0, 0 };
+    }
+#endif
+
+    return runCommand(&canvas, command, data);
+}
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+
+void tic_draw_replay(tic_mem* memory, const u8* commands, s32 size, s32 top, s32 bottom, tic_glyph_cache* glyphs)
+{
+    tic_core* core = (tic_core*)memory;
+
+    for (const u8 *ptr = commands, *end = commands + size; ptr != end; ptr += ((const DrawCommand*)ptr)->size)
+    {
+        const DrawCommand* command = (const DrawCommand*)ptr;
+        Canvas canvas = { core, command->clip, top, bottom, glyphs };
+
+        canvas.clip.t = MAX(canvas.clip.t, top);
+        canvas.clip.b = MIN(canvas.clip.b, bottom);
+
+        // a mesh still clears the depth rows of the band
+        if (canvas.clip.t < canvas.clip.b || command->type == DrawMesh)
+            runCommand(&canvas, command, command + 1);
+    }
 }
+
+#endif
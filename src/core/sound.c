@@ -24,6 +24,7 @@
 #include "api.h"
 #include "core.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #define ENVELOPE_FREQ_SCALE 2
@@ -88,13 +89,43 @@ static inline s32 getAmp(const tic_sound_register* reg, s32 amp)
 
 static void runEnvelope(blip_buffer_t* blip, const tic_sound_register* reg, tic_sound_register_data* data, s32 end_time, u8 volume)
 {
+    if (data->time >= end_time) return;
+
     s32 period = freq2period(reg->freq * ENVELOPE_FREQ_SCALE);
 
+    s32 amps[WAVE_VALUES];
+    bool constant = true;
+
+    for (s32 i = 0; i < WAVE_VALUES; i++)
+    {
+        amps[i] = getAmp(reg, tic_tool_peek4(reg->waveform.data, i) * volume / MAX_VOLUME);
+        constant &= amps[i] == amps[0];
+    }
+
+    // silent or flat channel, only the first step can change the amplitude
+    if (constant)
+    {
+        s32 steps = (end_time - data->time + period - 1) / period;
+
+        if (data->amp != amps[0])
+            update_amp(blip, data, amps[0]);
+
+        data->phase = (data->phase + steps) % WAVE_VALUES;
+        data->time += steps * period;
+        return;
+    }
+
     for (; data->time < end_time; data->time += period)
     {
         data->phase = (data->phase + 1) % WAVE_VALUES;
 
-        update_amp(blip, data, getAmp(reg, tic_tool_peek4(reg->waveform.data, data->phase) * volume / MAX_VOLUME));
+        s32 delta = amps[data->phase] - data->amp;
+
+        if (delta)
+        {
+            data->amp += delta;
+            blip_add_delta(blip, data->time, delta);
+        }
     }
 }
 
@@ -105,30 +136,83 @@ static void runNoise(blip_buffer_t* blip, const tic_sound_register* reg, tic_sou
         data->phase = 1;
 
     s32 period = freq2period(reg->freq);
+    s32 high = getAmp(reg, volume);
+    s32 low = getAmp(reg, 0);
+
+    // the LFSR keeps running while silent, but there is nothing to emit
+    if (high == low)
+    {
+        if (data->time < end_time && data->amp != low)
+            update_amp(blip, data, low);
+
+        for (; data->time < end_time; data->time += period)
+            data->phase = ((data->phase & 1) * (0b11 << 13)) ^ (data->phase >> 1);
+
+        return;
+    }
 
     for (; data->time < end_time; data->time += period)
     {
         data->phase = ((data->phase & 1) * (0b11 << 13)) ^ (data->phase >> 1);
-        update_amp(blip, data, getAmp(reg, (data->phase & 1) ? volume : 0));
+
+        s32 delta = ((data->phase & 1) ? high : low) - data->amp;
+
+        if (delta)
+        {
+            data->amp += delta;
+            blip_add_delta(blip, data->time, delta);
+        }
     }
 }
 
-static s32 calcLoopPos(const tic_sound_loop* loop, s32 pos)
+static inline s32 nextLoopPos(const tic_sound_loop* loop, s32 offset)
 {
-    s32 offset = 0;
-
     if (loop->size > 0)
+        return offset < (loop->start + loop->size - 1) ? offset + 1 : loop->start;
+
+    return offset + 1 >= SFX_TICKS ? SFX_TICKS - 1 : offset + 1;
+}
+
+static const tic_sfx_table* getSfxTable(tic_core* core, s32 index)
+{
+    const tic_sample* effect = &core->memory.ram.sfx.samples.data[index];
+    tic_sfx_table* table = &core->sfx[index];
+
+    if (table->ready && memcmp(&table->raw, effect, sizeof(tic_sample)) == 0)
+        return table;
+
+    table->raw = *effect;
+    table->ready = true;
+
+    for (s32 i = 0; i < sizeof(tic_sfx_pos); i++)
     {
-        for (s32 i = 0; i < pos; i++)
+        for (s32 t = 0, pos = 0; t < SFX_TABLE_TICKS; t++, pos = nextLoopPos(effect->loops + i, pos))
         {
-            if (offset < (loop->start + loop->size - 1))
-                offset++;
-            else offset = loop->start;
+            s32 value = 0;
+            switch (i)
+            {
+            case 0: value = effect->data[pos].wave; break;
+            case 1: value = MAX_VOLUME - effect->data[pos].volume; break;
+            case 2: value = effect->data[pos].chord * (effect->reverse ? -1 : 1); break;
+            case 3: value = effect->data[pos].pitch * (effect->pitch16x ? 16 : 1); break;
+            }
+
+            table->ticks[i][t].pos = pos;
+            table->ticks[i][t].value = value;
         }
     }
-    else offset = pos >= SFX_TICKS ? SFX_TICKS - 1 : pos;
 
-    return offset;
+    return table;
+}
+
+// past the table the positions are periodic with the loop size
+static inline s32 sfxTickPos(const tic_sound_loop* loop, s32 pos)
+{
+    if (pos < SFX_TABLE_TICKS)
+        return pos;
+
+    s32 size = loop->size ? loop->size : 1;
+    return SFX_TABLE_TICKS - size + (pos - SFX_TABLE_TICKS) % size;
 }
 
 static void resetSfxPos(tic_channel_data* channel)
@@ -150,25 +234,31 @@ static void sfx(tic_mem* memory, s32 index, s32 note, s32 pitch, tic_channel_dat
         return;
     }
 
-    const tic_sample* effect = &memory->ram.sfx.samples.data[index];
+    const tic_sfx_table* table = getSfxTable(core, index);
+    const tic_sample* effect = &table->raw;
     s32 pos = tic_tool_sfx_pos(channel->speed, ++channel->tick);
 
+    s8 values[sizeof(tic_sfx_pos)];
     for (s32 i = 0; i < sizeof(tic_sfx_pos); i++)
-        *(channel->pos->data + i) = calcLoopPos(effect->loops + i, pos);
+    {
+        s32 tick = sfxTickPos(effect->loops + i, pos);
+        *(channel->pos->data + i) = table->ticks[i][tick].pos;
+        values[i] = table->ticks[i][tick].value;
+    }
 
-    u8 volume = MAX_VOLUME - effect->data[channel->pos->volume].volume;
+    u8 volume = values[1];
 
     if (volume > 0)
     {
-        s8 arp = effect->data[channel->pos->chord].chord * (effect->reverse ? -1 : 1);
+        s8 arp = values[2];
         if (arp) note += arp;
 
         note = CLAMP(note, 0, COUNT_OF(NoteFreqs) - 1);
 
-        reg->freq = NoteFreqs[note] + effect->data[channel->pos->pitch].pitch * (effect->pitch16x ? 16 : 1) + pitch;
+        reg->freq = NoteFreqs[note] + values[3] + pitch;
         reg->volume = volume;
 
-        u8 wave = effect->data[channel->pos->wave].wave;
+        u8 wave = values[0];
         const tic_waveform* waveform = &memory->ram.sfx.waveforms.items[wave];
         memcpy(reg->waveform.data, waveform->data, sizeof(tic_waveform));
 
@@ -437,6 +527,134 @@ static void setSfxChannelData(tic_mem* memory, s32 index, s32 note, s32 octave,
     setChannelData(memory, index, note, octave, duration, &core->state.sfx.channels[channel], left, right, speed);
 }
 
+static void setMusic(tic_core* core, s32 index, s32 frame, s32 row, bool loop, bool sustain);
+
+static void buildMusicIndex(tic_core* core, tic_music_index* index, s32 track, bool sustain)
+{
+    tic_mem* memory = (tic_mem*)core;
+    tic_sound_state* sound_state = &memory->ram.sound_state;
+
+    // the track is played on the live state, which is put back afterwards
+    tic_sound_state state = *sound_state;
+    tic_music_state_data music = core->state.music;
+    tic_stereo_volume stereo = memory->ram.stereo;
+    tic_sound_register registers[TIC_SOUND_CHANNELS];
+    memcpy(registers, memory->ram.registers, sizeof registers);
+
+    index->music = memory->ram.music;
+    index->samples = memory->ram.sfx.samples;
+    index->track = track;
+    index->sustain = sustain;
+
+    for (s32 f = 0; f < MUSIC_FRAMES; f++)
+    {
+        index->start[f] = -1;
+
+        // fast tempos skip rows, those are marked with frame -1
+        for (s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
+            index->rows[f][r].frame = -1;
+    }
+
+    // the replay starts clean, the commands of whatever played before aren't baked in
+    resetMusicChannels(memory);
+    setMusic(core, track, -1, -1, false, sustain);
+    index->start[0] = 0;
+
+    s32 tick = 0;
+    for (; sound_state->flag.music_state != tic_music_stop; tick++)
+    {
+        // rows are indexed in order, a pending jump is never taken
+        memset(&core->state.music.jump, 0, sizeof(tic_jump_command));
+
+        tic_music_checkpoint checkpoint = {sound_state->music.frame, sound_state->music.row, core->state.music};
+
+        processMusic(memory);
+
+        // corrupted speed runs the rows backwards, such a track never ends
+        if (sound_state->flag.music_state == tic_music_stop || sound_state->music.row < 0)
+            break;
+
+        if (sound_state->music.frame != checkpoint.frame)
+        {
+            index->start[sound_state->music.frame] = tick;
+
+            // a new frame starts from row -1 with the channels reset as on the wrap,
+            // so it can be played alone in the frame mode too
+            tic_music_state_data played = core->state.music;
+            core->state.music = checkpoint.music;
+            core->state.music.ticks = 0;
+
+            if (!sustain)
+            {
+                resetMusicChannels(memory);
+
+                for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+                    setMusicChannelData(memory, -1, 0, 0, MAX_VOLUME, MAX_VOLUME, c);
+            }
+
+            checkpoint = (tic_music_checkpoint){sound_state->music.frame, -1, core->state.music};
+            core->state.music = played;
+        }
+
+        if (checkpoint.frame == sound_state->music.frame && checkpoint.row == sound_state->music.row)
+            continue;
+
+        index->rows[sound_state->music.frame][sound_state->music.row] = checkpoint;
+    }
+
+    index->duration = tick;
+
+    *sound_state = state;
+    core->state.music = music;
+    memory->ram.stereo = stereo;
+    memcpy(memory->ram.registers, registers, sizeof registers);
+}
+
+static const tic_music_index* getMusicIndex(tic_core* core, s32 track, bool sustain)
+{
+    tic_mem* memory = (tic_mem*)core;
+    tic_music_index* index = core->seek;
+
+    if (index && index->track == track && index->sustain == sustain
+        && memcmp(&index->music, &memory->ram.music, sizeof(tic_music)) == 0
+        && memcmp(&index->samples, &memory->ram.sfx.samples, sizeof(tic_samples)) == 0)
+        return index;
+
+    if (!index && !(index = core->seek = malloc(sizeof(tic_music_index))))
+        return NULL;
+
+    buildMusicIndex(core, index, track, sustain);
+
+    return index;
+}
+
+// restores the state the track would have reached playing from the start,
+// so the row is played with the commands of the previous rows in effect
+static void seekMusic(tic_core* core, s32 index, s32 frame, s32 row, bool sustain)
+{
+    tic_mem* memory = (tic_mem*)core;
+    const tic_music_index* seek = getMusicIndex(core, index, sustain);
+    const tic_track* track = &memory->ram.music.tracks.data[index];
+
+    s32 rows = MUSIC_PATTERN_ROWS - track->rows;
+
+    if (!seek || frame >= MUSIC_FRAMES || seek->start[frame] < 0)
+        return;
+
+    // a skipped row starts at the next played one
+    while (row < rows && seek->rows[frame][row].frame < 0)
+        row++;
+
+    if (row >= rows)
+        return;
+
+    const tic_music_checkpoint* checkpoint = &seek->rows[frame][row];
+
+    memory->ram.sound_state.music.frame = checkpoint->frame;
+    memory->ram.sound_state.music.row = checkpoint->row;
+    core->state.music = checkpoint->music;
+}
+
 static void setMusic(tic_core* core, s32 index, s32 frame, s32 row, bool loop, bool sustain)
 {
     tic_mem* memory = (tic_mem*)core;
@@ -450,6 +668,8 @@ static void setMusic(tic_core* core, s32 index, s32 frame, s32 row, bool loop, b
     }
     else
     {
+        resetMusicChannels(memory);
+
         for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
             setMusicChannelData(memory, -1, 0, 0, MAX_VOLUME, MAX_VOLUME, c);
 
@@ -461,6 +681,15 @@ static void setMusic(tic_core* core, s32 index, s32 frame, s32 row, bool loop, b
 
         const tic_track* track = &memory->ram.music.tracks.data[index];
         core->state.music.ticks = row >= 0 ? row2tick(track, row) : 0;
+
+        if (frame > 0 || row >= 0)
+            seekMusic(core, index, frame < 0 ? 0 : frame, row < 0 ? 0 : row, sustain);
+        else
+        {
+            // the first row is played on the next tick
+            memory->ram.sound_state.music.row = -1;
+            core->state.music.ticks = 0;
+        }
     }
 }
 
@@ -474,20 +703,38 @@ void tic_api_music(tic_mem* memory, s32 index, s32 frame, s32 row, bool loop, bo
         memory->ram.sound_state.flag.music_state = tic_music_play;
 }
 
+tic_music_pos tic_api_mpos(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    const tic_sound_state* sound_state = &memory->ram.sound_state;
+
+    if (sound_state->flag.music_state == tic_music_stop || sound_state->music.track < 0)
+        return (tic_music_pos){-1, 0};
+
+    const tic_music_index* index = getMusicIndex(core, sound_state->music.track, sound_state->flag.music_sustain);
+
+    if (!index)
+        return (tic_music_pos){-1, 0};
+
+    s32 start = index->start[sound_state->music.frame];
+
+    return (tic_music_pos){start < 0 ? -1 : start + core->state.music.ticks, index->duration};
+}
+
 void tic_api_sfx(tic_mem* memory, s32 index, s32 note, s32 octave, s32 duration, s32 channel, s32 left, s32 right, s32 speed)
 {
     tic_core* core = (tic_core*)memory;
     setSfxChannelData(memory, index, note, octave, duration, channel, left, right, speed);
 }
 
-static void stereo_tick_end(tic_mem* memory, tic_sound_register_data* registers, blip_buffer_t* blip, u8 stereoRight)
+static void stereo_tick_end(const tic_sound_register* regs, const tic_stereo_volume* stereo, tic_sound_register_data* registers, blip_buffer_t* blip, u8 stereoRight)
 {
     enum { EndTime = CLOCKRATE / TIC80_FRAMERATE };
     for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
     {
-        u8 volume = tic_tool_peek4(&memory->ram.stereo.data, stereoRight + i * 2);
+        u8 volume = tic_tool_peek4(&stereo->data, stereoRight + i * 2);
 
-        const tic_sound_register* reg = &memory->ram.registers[i];
+        const tic_sound_register* reg = &regs[i];
         tic_sound_register_data* data = registers + i;
 
         tic_tool_is_noise(&reg->waveform)
@@ -520,13 +767,31 @@ void tic_core_sound_tick_start(tic_mem* memory)
     }
 }
 
+s32 tic_core_sound_synth(tic_core* core, const tic_sound_register* registers, const tic_stereo_volume* stereo, s16* samples)
+{
+    stereo_tick_end(registers, stereo, core->state.registers.left, core->blip.left, 0);
+    stereo_tick_end(registers, stereo, core->state.registers.right, core->blip.right, 1);
+
+    // blip keeps the fractional sample of each frame, so the output never drifts
+    s32 count = MIN(blip_samples_avail(core->blip.left), TIC_FRAME_SAMPLES_MAX(core->samplerate));
+
+    blip_read_samples(core->blip.left, samples, count, TIC_STEREO_CHANNELS);
+    blip_read_samples(core->blip.right, samples + 1, count, TIC_STEREO_CHANNELS);
+
+    return count * TIC_STEREO_CHANNELS * sizeof(s16);
+}
+
 void tic_core_sound_tick_end(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
 
-    stereo_tick_end(memory, core->state.registers.left, core->blip.left, 0);
-    stereo_tick_end(memory, core->state.registers.right, core->blip.right, 1);
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+    if (core->synth)
+    {
+        memory->samples.size = tic_synth_push(core->synth, memory->samples.buffer);
+        return;
+    }
+#endif
 
-    blip_read_samples(core->blip.left, core->memory.samples.buffer, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
-    blip_read_samples(core->blip.right, core->memory.samples.buffer + 1, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
+    memory->samples.size = tic_core_sound_synth(core, memory->ram.registers, &memory->ram.stereo, memory->samples.buffer);
 }
@@ -0,0 +1,164 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core.h"
+
+#if defined(TIC_BUILD_WITH_AUDIO_THREAD)
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The game thread publishes the sound registers of each frame and a worker
+// runs the synthesis while the next frame is being computed. Only one frame
+// is in flight: the samples handed out at the end of frame N are the ones
+// synthesized from frame N-1, and the worker owns the blip buffers and the
+// register phase data until it is done with it.
+
+struct tic_synth
+{
+    tic_core* core;
+
+    tic_sound_register registers[TIC_SOUND_CHANNELS];
+    tic_stereo_volume stereo;
+
+    s16* samples;
+    s32 size; // bytes of the last synthesized frame
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    u32 pushed;
+    u32 synthesized;
+    bool quit;
+};
+
+static void* synthThread(void* data)
+{
+    tic_synth* synth = data;
+
+    pthread_mutex_lock(&synth->lock);
+
+    for (;;)
+    {
+        while (!synth->quit && synth->synthesized == synth->pushed)
+            pthread_cond_wait(&synth->start, &synth->lock);
+
+        if (synth->quit) break;
+
+        pthread_mutex_unlock(&synth->lock);
+
+        s32 size = tic_core_sound_synth(synth->core, synth->registers, &synth->stereo, synth->samples);
+
+        pthread_mutex_lock(&synth->lock);
+        synth->size = size;
+        synth->synthesized++;
+        pthread_cond_signal(&synth->done);
+    }
+
+    pthread_mutex_unlock(&synth->lock);
+
+    return NULL;
+}
+
+static void waitSynth(tic_synth* synth)
+{
+    while (synth->synthesized != synth->pushed)
+        pthread_cond_wait(&synth->done, &synth->lock);
+}
+
+tic_synth* tic_synth_create(tic_mem* memory)
+{
+    tic_synth* synth = (tic_synth*)malloc(sizeof(tic_synth));
+
+    if (!synth) return NULL;
+
+    memset(synth, 0, sizeof(tic_synth));
+    synth->core = (tic_core*)memory;
+    synth->size = memory->samples.size;
+    synth->samples = calloc(TIC_FRAME_SAMPLES_MAX(synth->core->samplerate) * TIC_STEREO_CHANNELS, sizeof(s16));
+
+    pthread_mutex_init(&synth->lock, NULL);
+    pthread_cond_init(&synth->start, NULL);
+    pthread_cond_init(&synth->done, NULL);
+
+    if (!synth->samples || pthread_create(&synth->thread, NULL, synthThread, synth) != 0)
+    {
+        pthread_cond_destroy(&synth->done);
+        pthread_cond_destroy(&synth->start);
+        pthread_mutex_destroy(&synth->lock);
+        free(synth->samples);
+        free(synth);
+        return NULL;
+    }
+
+    return synth;
+}
+
+void tic_synth_close(tic_synth* synth)
+{
+    pthread_mutex_lock(&synth->lock);
+    waitSynth(synth);
+    synth->quit = true;
+    pthread_cond_signal(&synth->start);
+    pthread_mutex_unlock(&synth->lock);
+
+    pthread_join(synth->thread, NULL);
+
+    pthread_cond_destroy(&synth->done);
+    pthread_cond_destroy(&synth->start);
+    pthread_mutex_destroy(&synth->lock);
+
+    free(synth->samples);
+    free(synth);
+}
+
+s32 tic_synth_push(tic_synth* synth, s16* samples)
+{
+    tic_mem* memory = &synth->core->memory;
+
+    pthread_mutex_lock(&synth->lock);
+
+    // the previous frame has had a whole tick to finish, this rarely waits
+    waitSynth(synth);
+
+    s32 size = synth->size;
+    memcpy(samples, synth->samples, size);
+    memcpy(synth->registers, memory->ram.registers, sizeof synth->registers);
+    synth->stereo = memory->ram.stereo;
+
+    synth->pushed++;
+    pthread_cond_signal(&synth->start);
+    pthread_mutex_unlock(&synth->lock);
+
+    return size;
+}
+
+void tic_synth_sync(tic_synth* synth)
+{
+    pthread_mutex_lock(&synth->lock);
+    waitSynth(synth);
+    pthread_mutex_unlock(&synth->lock);
+}
+
+#endif
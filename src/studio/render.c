@@ -0,0 +1,403 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "render.h"
+#include "api.h"
+#include "tools.h"
+#include "wave_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(TIC_BUILD_WITH_THREADS)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define RENDER_MAX_WORKERS 8
+
+typedef struct
+{
+    s16* data;
+    s32 count;
+    s32 capacity;
+    bool failed; // a frame couldn't be stored, the samples are incomplete
+} Samples;
+
+typedef void(*FrameCallback)(void* data, const s16* samples, s32 count);
+
+static tic_mem* createCore(const tic_cartridge* cart, s32 bank, s32 samplerate)
+{
+    tic_mem* tic = tic_core_create(samplerate);
+
+    if(tic)
+    {
+        tic_core_offline(tic);
+
+        memcpy(&tic->ram.sfx, &cart->banks[bank].sfx, sizeof tic->ram.sfx);
+        memcpy(&tic->ram.music, &cart->banks[bank].music, sizeof tic->ram.music);
+    }
+
+    return tic;
+}
+
+static void writeFrame(void* data, const s16* samples, s32 count)
+{
+    wave_write(samples, count);
+}
+
+static void appendFrame(void* data, const s16* samples, s32 count)
+{
+    Samples* buffer = data;
+
+    if(buffer->failed || count <= 0) return;
+
+    if(buffer->count + count > buffer->capacity)
+    {
+        s32 capacity = buffer->capacity ? buffer->capacity * 2 : count * TIC80_FRAMERATE * 60;
+        s16* ptr = realloc(buffer->data, capacity * sizeof(s16));
+
+        if(!ptr)
+        {
+            buffer->failed = true;
+            return;
+        }
+
+        buffer->data = ptr;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->count, samples, count * sizeof(s16));
+    buffer->count += count;
+}
+
+static bool renderSfx(const tic_cartridge* cart, s32 bank, s32 index, s32 samplerate, FrameCallback callback, void* data)
+{
+    tic_mem* tic = createCore(cart, bank, samplerate);
+
+    if(!tic) return false;
+
+    const tic_sample* effect = &tic->ram.sfx.samples.data[index];
+
+    enum{Channel = 0};
+    tic_api_sfx(tic, index, effect->note, effect->octave, -1, Channel, MAX_VOLUME, MAX_VOLUME, SFX_DEF_SPEED);
+
+    for(s32 ticks = 0, pos = 0; pos < SFX_TICKS; pos = tic_tool_sfx_pos(effect->speed, ++ticks))
+    {
+        tic_core_tick_start(tic);
+        tic_core_tick_end(tic);
+
+        callback(data, tic->samples.buffer, tic->samples.size / sizeof(s16));
+    }
+
+    tic_core_close(tic);
+
+    return true;
+}
+
+static bool renderMusic(const tic_cartridge* cart, s32 bank, s32 track, s32 samplerate, u8 channels, bool sustain, FrameCallback callback, void* data)
+{
+    tic_mem* tic = createCore(cart, bank, samplerate);
+
+    if(!tic) return false;
+
+    const tic_sound_state* state = &tic->ram.sound_state;
+
+    tic_api_music(tic, track, -1, -1, false, sustain);
+
+    for(s32 frame = 0; frame < RENDER_MAX_FRAMES && state->flag.music_state == tic_music_play; frame++)
+    {
+        tic_core_tick_start(tic);
+
+        for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+            if(!(channels & (1 << i)))
+                tic->ram.registers[i].volume = 0;
+
+        tic_core_tick_end(tic);
+
+        callback(data, tic->samples.buffer, tic->samples.size / sizeof(s16));
+    }
+
+    tic_core_close(tic);
+
+    return true;
+}
+
+static bool openWave(s32 samplerate, const char* path)
+{
+    if(wave_open(samplerate, path))
+    {
+#if TIC_STEREO_CHANNELS == 2
+        wave_enable_stereo();
+#endif
+        return true;
+    }
+
+    return false;
+}
+
+bool tic_render_sfx(const tic_cartridge* cart, s32 bank, s32 index, s32 samplerate, const char* path)
+{
+    if(!openWave(samplerate, path)) return false;
+
+    bool done = renderSfx(cart, bank, index, samplerate, writeFrame, NULL);
+    wave_close();
+
+    return done;
+}
+
+bool tic_render_music(const tic_cartridge* cart, s32 bank, s32 track, s32 samplerate, u8 channels, bool sustain, const char* path)
+{
+    if(!openWave(samplerate, path)) return false;
+
+    bool done = renderMusic(cart, bank, track, samplerate, channels, sustain, writeFrame, NULL);
+    wave_close();
+
+    return done;
+}
+
+typedef struct
+{
+    s32 bank;
+    s32 track;
+    bool done;
+    Samples samples;
+} TrackJob;
+
+typedef struct
+{
+    const tic_cartridge* cart;
+    s32 samplerate;
+
+    TrackJob jobs[TIC_BANKS * MUSIC_TRACKS];
+    s32 count;
+
+    // jobs are taken in order and written in order, at most `ahead`
+    // rendered tracks wait in memory for the writer
+    s32 next;
+    s32 written;
+    s32 ahead;
+
+#if defined(TIC_BUILD_WITH_THREADS)
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+#endif
+} Soundtrack;
+
+static bool isTrackEmpty(const tic_track* track)
+{
+    for (s32 c = 0; c < TIC_SOUND_CHANNELS; c++)
+        if(tic_tool_get_pattern_id(track, 0, c))
+            return false;
+
+    return true;
+}
+
+static void renderJob(Soundtrack* soundtrack, TrackJob* job)
+{
+    enum {AllChannels = (1 << TIC_SOUND_CHANNELS) - 1};
+
+    if(!renderMusic(soundtrack->cart, job->bank, job->track, soundtrack->samplerate,
+        AllChannels, false, appendFrame, &job->samples))
+        job->samples.failed = true;
+}
+
+// false when the track failed to render or its file can't be written,
+// the export stops there instead of leaving a truncated wav behind
+static bool writeJob(Soundtrack* soundtrack, TrackJob* job, tic_render_path getPath, void* data, s32* files)
+{
+    bool done = !job->samples.failed;
+
+    if(done && job->samples.data)
+    {
+        done = openWave(soundtrack->samplerate, getPath(data, job->bank, job->track));
+
+        if(done)
+        {
+            wave_write(job->samples.data, job->samples.count);
+            wave_close();
+            (*files)++;
+        }
+    }
+
+    free(job->samples.data);
+    job->samples = (Samples){0};
+
+    return done;
+}
+
+#if defined(TIC_BUILD_WITH_THREADS)
+
+static void* renderThread(void* data)
+{
+    Soundtrack* soundtrack = data;
+
+    pthread_mutex_lock(&soundtrack->lock);
+
+    for(;;)
+    {
+        while(soundtrack->next < soundtrack->count
+            && soundtrack->next >= soundtrack->written + soundtrack->ahead)
+            pthread_cond_wait(&soundtrack->changed, &soundtrack->lock);
+
+        if(soundtrack->next >= soundtrack->count) break;
+
+        TrackJob* job = &soundtrack->jobs[soundtrack->next++];
+        pthread_mutex_unlock(&soundtrack->lock);
+
+        renderJob(soundtrack, job);
+
+        pthread_mutex_lock(&soundtrack->lock);
+        job->done = true;
+        pthread_cond_broadcast(&soundtrack->changed);
+    }
+
+    pthread_mutex_unlock(&soundtrack->lock);
+
+    return NULL;
+}
+
+static s32 getWorkersCount()
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > RENDER_MAX_WORKERS ? RENDER_MAX_WORKERS : (s32)cores;
+#else
+    return RENDER_MAX_WORKERS / 2;
+#endif
+}
+
+#endif
+
+static s32 renderSerial(Soundtrack* soundtrack, tic_render_path getPath, tic_render_progress progress, void* data)
+{
+    s32 files = 0;
+
+    for(s32 i = 0; i < soundtrack->count; i++)
+    {
+        TrackJob* job = &soundtrack->jobs[i];
+
+        renderJob(soundtrack, job);
+
+        if(!writeJob(soundtrack, job, getPath, data, &files))
+            return -1;
+
+        if(progress)
+            progress(data, i + 1, soundtrack->count);
+    }
+
+    return files;
+}
+
+#if defined(TIC_BUILD_WITH_THREADS)
+
+static s32 renderParallel(Soundtrack* soundtrack, tic_render_path getPath, tic_render_progress progress, void* data)
+{
+    pthread_t threads[RENDER_MAX_WORKERS];
+    s32 workers = 0;
+    s32 files = 0;
+
+    pthread_mutex_init(&soundtrack->lock, NULL);
+    pthread_cond_init(&soundtrack->changed, NULL);
+
+    s32 count = getWorkersCount();
+    soundtrack->ahead = count * 2;
+
+    for(s32 i = 0; i < count; i++)
+        if(pthread_create(&threads[workers], NULL, renderThread, soundtrack) == 0)
+            workers++;
+
+    if(workers)
+    {
+        // the writer streams finished tracks into wave_writer in order, while
+        // the workers render the following ones
+        for(s32 i = 0; i < soundtrack->count; i++)
+        {
+            TrackJob* job = &soundtrack->jobs[i];
+
+            pthread_mutex_lock(&soundtrack->lock);
+            while(!job->done)
+                pthread_cond_wait(&soundtrack->changed, &soundtrack->lock);
+            pthread_mutex_unlock(&soundtrack->lock);
+
+            bool written = writeJob(soundtrack, job, getPath, data, &files);
+
+            pthread_mutex_lock(&soundtrack->lock);
+            soundtrack->written = i + 1;
+
+            // no more jobs are handed out, the running ones finish and are dropped
+            if(!written)
+                soundtrack->next = soundtrack->count;
+
+            pthread_cond_broadcast(&soundtrack->changed);
+            pthread_mutex_unlock(&soundtrack->lock);
+
+            if(!written)
+            {
+                files = -1;
+                break;
+            }
+
+            if(progress)
+                progress(data, i + 1, soundtrack->count);
+        }
+
+        for(s32 i = 0; i < workers; i++)
+            pthread_join(threads[i], NULL);
+
+        for(s32 i = 0; i < soundtrack->count; i++)
+            free(soundtrack->jobs[i].samples.data);
+    }
+    else files = renderSerial(soundtrack, getPath, progress, data);
+
+    pthread_cond_destroy(&soundtrack->changed);
+    pthread_mutex_destroy(&soundtrack->lock);
+
+    return files;
+}
+
+#endif
+
+s32 tic_render_soundtrack(const tic_cartridge* cart, s32 samplerate, tic_render_path getPath, tic_render_progress progress, void* data)
+{
+    Soundtrack* soundtrack = calloc(1, sizeof(Soundtrack));
+
+    if(!soundtrack) return 0;
+
+    soundtrack->cart = cart;
+    soundtrack->samplerate = samplerate;
+
+    for(s32 b = 0; b < TIC_BANKS; b++)
+        for(s32 t = 0; t < MUSIC_TRACKS; t++)
+            if(!isTrackEmpty(&cart->banks[b].music.tracks.data[t]))
+                soundtrack->jobs[soundtrack->count++] = (TrackJob){.bank = b, .track = t};
+
+#if defined(TIC_BUILD_WITH_THREADS)
+    s32 files = renderParallel(soundtrack, getPath, progress, data);
+#else
+    s32 files = renderSerial(soundtrack, getPath, progress, data);
+#endif
+
+    free(soundtrack);
+
+    return files;
+}
@@ -0,0 +1,39 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "cart.h"
+
+// the longest track rendered, guards against music that jumps back forever
+#define RENDER_MAX_FRAMES (TIC80_FRAMERATE * 60 * 10)
+
+typedef void(*tic_render_progress)(void* data, s32 done, s32 total);
+typedef const char*(*tic_render_path)(void* data, s32 bank, s32 track);
+
+// offline renderers, each runs on a private core and writes a wav file
+bool tic_render_sfx(const tic_cartridge* cart, s32 bank, s32 index, s32 samplerate, const char* path);
+bool tic_render_music(const tic_cartridge* cart, s32 bank, s32 track, s32 samplerate, u8 channels, bool sustain, const char* path);
+
+// renders every non-empty track of every bank, in parallel where threads are available,
+// returns the number of written files, -1 when a track failed and the export was stopped
+s32 tic_render_soundtrack(const tic_cartridge* cart, s32 samplerate, tic_render_path getPath, tic_render_progress progress, void* data);
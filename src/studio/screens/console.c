@@ -1193,6 +1193,35 @@ static void onConsoleVersionCommand(Console* console, const char* param)
     commandDone(console);
 }
 
+static void onConsoleAudioCommand(Console* console, const char* param)
+{
+    if(getSystem()->audioStats)
+    {
+        u32 underruns = 0, overruns = 0;
+        s32 latency = 0;
+        getSystem()->audioStats(&underruns, &overruns, &latency);
+
+        char buf[STUDIO_TEXT_BUFFER_WIDTH * 3];
+        sprintf(buf, "\nunderruns: %u\noverruns:  %u\nbuffered:  %i ms", underruns, overruns, latency);
+        printBack(console, buf);
+    }
+    else printError(console, "\naudio stats are not available");
+
+    commandDone(console);
+}
+
+static void onConsoleStatsCommand(Console* console, const char* param)
+{
+    tic_tick_stats stats = tic_core_tick_stats(console->tic);
+
+    char buf[STUDIO_TEXT_BUFFER_WIDTH * 5];
+    sprintf(buf, "\nticks:     %u\nspikes:    %u\nworst:     %u us\nidle:      %u ms\ncallbacks: %u resolved",
+        stats.ticks, stats.spikes, stats.worst, (u32)(stats.idle / 1000), tic_core_callback_resolves(console->tic));
+    printBack(console, buf);
+
+    commandDone(console);
+}
+
 static void onConsoleConfigCommand(Console* console, const char* param)
 {
     if(param == NULL)
@@ -1494,6 +1523,38 @@ static void exportMusic(Console* console, s32 track, const char* filename)
     }
 }
 
+static void onSoundtrackProgress(void* data, s32 done, s32 total)
+{
+    Console* console = data;
+
+    console->cursor.x = 0;
+    printf("\r");
+    printBack(console, "rendering tracks ");
+
+    char buf[16];
+    sprintf(buf, "[%i/%i]", done, total);
+    printFront(console, buf);
+}
+
+static void exportSoundtrack(Console* console, const char* name)
+{
+    printLine(console);
+
+    s32 files = studioExportSoundtrack(name, onSoundtrackProgress, console);
+
+    if(files > 0)
+    {
+        char buf[64];
+        sprintf(buf, "\n%i tracks exported :)", files);
+        printBack(console, buf);
+    }
+    else if(files < 0)
+        printError(console, "\nerror: soundtrack export failed :(");
+    else printError(console, "\nno music to export :(");
+
+    commandDone(console);
+}
+
 static void exportSprites(Console* console, const char* filename)
 {
     enum
@@ -1577,6 +1638,17 @@ static void *ticMemmem(const void* haystack, size_t hlen, const void* needle, si
     return NULL;
 }
 
+// a binary left from the loaded cart could be stale, it is rebuilt or dropped on every save
+static void updateCartBinary(Console* console)
+{
+    tic_mem* tic = console->tic;
+
+    if(getConfig()->precompile)
+        tic_core_compile(tic);
+    else
+        tic->cart.binary.size = 0;
+}
+
 static const char TicCartSig[] = "TIC.CART";
 #define SIG_SIZE (sizeof TicCartSig-1)
 
@@ -1595,6 +1667,7 @@ static void* embedCart(Console* console, u8* app, s32* size)
 
     if(cart)
     {
+        updateCartBinary(console);
         s32 cartSize = tic_cart_save(&tic->cart, cart);
 
         s32 zipSize = sizeof(tic_cartridge);
@@ -1770,6 +1843,7 @@ static void onHtmlExportGet(const HttpGetData* data)
 
                 if(cart)
                 {
+                    updateCartBinary(console);
                     s32 cartSize = tic_cart_save(&tic->cart, cart);
 
                     if(cartSize)
@@ -1847,6 +1921,8 @@ static void onConsoleExportCommand(Console* console, const char* param)
             exportSfx(console, atoi(param + SfxIndex) % SFX_COUNT, getFilename(filename, ".wav"));
         else if(strncmp(param, "music", MusicIndex) == 0)
             exportMusic(console, atoi(param + MusicIndex) % MUSIC_TRACKS, getFilename(filename, ".wav"));
+        else if(strcmp(param, "soundtrack") == 0)
+            exportSoundtrack(console, filename);
         else if(strcmp(param, "win") == 0)
             exportNativeGame(console, getFilename(filename, ".exe"), param);
         else if(strcmp(param, "linux") == 0)
@@ -1865,7 +1941,7 @@ static void onConsoleExportCommand(Console* console, const char* param)
     else
     {
         printBack(console, "\nusage: export (");
-        printFront(console, "win linux rpi mac html sprites map cover sfx<#> music<#>");
+        printFront(console, "win linux rpi mac html sprites map cover sfx<#> music<#> soundtrack");
         printBack(console, ") file\n");
         commandDone(console);
     }
@@ -1901,6 +1977,7 @@ static CartSaveResult saveCartName(Console* console, const char* name)
                 else
                 {
                     name = getCartName(name);
+                    updateCartBinary(console);
                     size = tic_cart_save(&tic->cart, buffer);
                 }
 
@@ -2299,6 +2376,8 @@ static const struct
     {"demo",    NULL, "install demo carts",         onConsoleInstallDemosCommand},
     {"config",  NULL, "edit TIC config",            onConsoleConfigCommand},
     {"version", NULL, "show the current version",   onConsoleVersionCommand},
+    {"audio",   NULL, "show audio buffer stats",    onConsoleAudioCommand},
+    {"stats",   NULL, "show last run tick stats",   onConsoleStatsCommand},
     {"surf",    NULL, "open carts browser",         onConsoleSurfCommand},
     {"menu",    NULL, "show game menu",             onConsoleGameMenuCommand},
 };
@@ -2978,6 +3057,9 @@ void initConsole(Console* console, tic_mem* tic, FileSystem* fs, Config* config,
                             {
                                 tic_cart_load(console->embed.file, data, dataSize);
                                 console->embed.yes = true;
+
+                                // the cart ships inside this executable, its binary is as trusted as the code
+                                console->embed.file->binary.trusted = true;
                             }
                             
                             free(data);
@@ -96,6 +96,56 @@ static void initPMemName(Run* run)
     strcat(run->saveid, md5);
 }
 
+// transpiled code is compiled once and cached, keyed by the source and the compiler,
+// the cache is local and trusted, the binary of a loaded cart is replaced unless trusted
+static void initBinaryCache(Run* run)
+{
+    tic_mem* tic = run->tic;
+    tic_binary* binary = &tic->cart.binary;
+    const char* code = tic->cart.code.data;
+    const tic_script_config* config = tic_core_script_config(tic);
+
+    if(getConfig()->trustBinary)
+        binary->trusted = true;
+
+    if(!config->compiler || !config->compile || (binary->trusted && tic_tool_binary_matches(binary, code)))
+        return;
+
+    char path[TICNAME_MAX];
+
+    {
+        char key[TICNAME_MAX];
+        snprintf(key, sizeof key, "%s %s %s", config->compiler, TIC_VERSION_LABEL, data2md5(code, (s32)strlen(code)));
+        snprintf(path, sizeof path, TIC_CACHE "%s.bin", data2md5(key, (s32)strlen(key)));
+    }
+
+    FileSystem* fs = run->console->fs;
+
+    s32 size = 0;
+    void* data = fsLoadRootFile(fs, path, &size);
+
+    if(data)
+    {
+        if(size <= TIC_BINARY_SIZE)
+        {
+            memcpy(binary->data, data, size);
+            binary->size = size;
+            binary->trusted = true;
+        }
+
+        free(data);
+
+        if(binary->trusted && tic_tool_binary_matches(binary, code))
+            return;
+    }
+
+    if(tic_core_compile(tic))
+    {
+        fsMakeDir(fs, TIC_CACHE);
+        fsSaveRootFile(fs, path, binary->data, binary->size, true);
+    }
+}
+
 static void tick(Run* run)
 {
     if (getStudioMode() != TIC_RUN_MODE)
@@ -176,6 +226,8 @@ void initRun(Run* run, Console* console, tic_mem* tic)
         memcpy(run->pmem.data, tic->ram.persistent.data, Size);
     }
 
+    initBinaryCache(run);
+
     getSystem()->preseed();
 }
 
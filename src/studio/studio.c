@@ -42,7 +42,6 @@
 
 #include "ext/gif.h"
 #include "ext/md5.h"
-#include "wave_writer.h"
 #include "argparse.h"
 
 #include <ctype.h>
@@ -289,43 +288,8 @@ const char* studioExportSfx(s32 index, const char* filename)
 
     const char* path = fsGetFilePath(impl.fs, filename);
 
-    if(wave_open( impl.samplerate, path ))
-    {
-
-#if TIC_STEREO_CHANNELS == 2
-        wave_enable_stereo();
-#endif
-
-        const tic_sfx* sfx = getSfxSrc();
-
-        sfx2ram(&tic->ram, sfx);
-        music2ram(&tic->ram, getMusicSrc());
-
-        {
-            const tic_sample* effect = &sfx->samples.data[index];
-
-            enum{Channel = 0};
-            sfx_stop(tic, Channel);
-            tic_api_sfx(tic, index, effect->note, effect->octave, -1, Channel, MAX_VOLUME, MAX_VOLUME, SFX_DEF_SPEED);
-
-            for(s32 ticks = 0, pos = 0; pos < SFX_TICKS; pos = tic_tool_sfx_pos(effect->speed, ++ticks))
-            {
-                tic_core_tick_start(tic);
-                tic_core_tick_end(tic);
-
-                wave_write(tic->samples.buffer, tic->samples.size / sizeof(s16));
-            }
-
-            sfx_stop(tic, Channel);
-            memset(tic->ram.registers, 0, sizeof(tic_sound_register));
-        }
-
-        wave_close();
-
-        return path;
-    }
-
-    return NULL;
+    return tic_render_sfx(&tic->cart, impl.bank.index.sfx, index, impl.samplerate, path)
+        ? path : NULL;
 }
 
 const char* studioExportMusic(s32 track, const char* filename)
@@ -333,42 +297,47 @@ const char* studioExportMusic(s32 track, const char* filename)
     tic_mem* tic = impl.studio.tic;
 
     const char* path = fsGetFilePath(impl.fs, filename);
+    const Music* editor = impl.banks.music[impl.bank.index.music];
 
-    if(wave_open( impl.samplerate, path ))
-    {
-#if TIC_STEREO_CHANNELS == 2
-        wave_enable_stereo();
-#endif
-
-        const tic_sfx* sfx = getSfxSrc();
-        const tic_music* music = getMusicSrc();
+    u8 channels = 0;
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+        if(editor->on[i])
+            channels |= 1 << i;
 
-        sfx2ram(&tic->ram, sfx);
-        music2ram(&tic->ram, music);
+    return tic_render_music(&tic->cart, impl.bank.index.music, track, impl.samplerate, channels, editor->sustain, path)
+        ? path : NULL;
+}
 
-        const tic_sound_state* state = &tic->ram.sound_state;
-        const Music* editor = impl.banks.music[impl.bank.index.music];
+typedef struct
+{
+    const char* name;
+    tic_render_progress progress;
+    void* data;
+} SoundtrackExport;
 
-        tic_api_music(tic, track, -1, -1, false, editor->sustain);
+static const char* getSoundtrackPath(void* data, s32 bank, s32 track)
+{
+    const SoundtrackExport* export = data;
 
-        while(state->flag.music_state == tic_music_play)
-        {
-            tic_core_tick_start(tic);
+    char filename[TICNAME_MAX];
+    snprintf(filename, sizeof filename, "%s-%i-%i.wav", export->name, bank, track);
 
-            for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
-                if(!editor->on[i])
-                    tic->ram.registers[i].volume = 0;
+    return fsGetFilePath(impl.fs, filename);
+}
 
-            tic_core_tick_end(tic);
+static void onSoundtrackProgress(void* data, s32 done, s32 total)
+{
+    const SoundtrackExport* export = data;
 
-            wave_write(tic->samples.buffer, tic->samples.size / sizeof(s16));
-        }
+    if(export->progress)
+        export->progress(export->data, done, total);
+}
 
-        wave_close();        
-        return path;
-    }
+s32 studioExportSoundtrack(const char* name, tic_render_progress progress, void* data)
+{
+    SoundtrackExport export = {name, progress, data};
 
-    return NULL;
+    return tic_render_soundtrack(&impl.studio.tic->cart, impl.samplerate, getSoundtrackPath, onSoundtrackProgress, &export);
 }
 
 void sfx_stop(tic_mem* tic, s32 channel)
@@ -1298,9 +1267,21 @@ static void initModules()
     initWorldMap();
 }
 
+// the binary is derived from the code, rebuilding it doesn't change the cart
+static void cartHash(CartHash* hash)
+{
+    const tic_cartridge* cart = &impl.studio.tic->cart;
+
+    MD5_CTX c;
+    MD5_Init(&c);
+    MD5_Update(&c, cart, offsetof(tic_cartridge, binary));
+    MD5_Update(&c, &cart->cover, sizeof cart->cover);
+    MD5_Final(hash->data, &c);
+}
+
 static void updateHash()
 {
-    md5(&impl.studio.tic->cart, sizeof(tic_cartridge), impl.cart.hash.data);
+    cartHash(&impl.cart.hash);
 }
 
 static void updateMDate()
@@ -1337,7 +1318,7 @@ void studioRomLoaded()
 bool studioCartChanged()
 {
     CartHash hash;
-    md5(&impl.studio.tic->cart, sizeof(tic_cartridge), hash.data);
+    cartHash(&hash);
 
     return memcmp(hash.data, impl.cart.hash.data, sizeof(CartHash)) != 0;
 }
@@ -1962,6 +1943,16 @@ static void studioTick()
     drawPopup();
 }
 
+// available is the spare time in us before the next frame
+static void studioIdle(s32 available)
+{
+    if(impl.mode == TIC_RUN_MODE)
+    {
+        s32 budget = getConfig()->gcBudget ? getConfig()->gcBudget : TIC80_IDLE_BUDGET;
+        tic_core_idle(impl.studio.tic, MIN(budget, available));
+    }
+}
+
 static void studioClose()
 {
     {
@@ -2006,8 +1997,12 @@ static StartArgs parseArgs(s32 argc, const char **argv)
         OPT_BOOLEAN('\0',   "skip",         &args.skip,         "skip startup animation"),
         OPT_BOOLEAN('\0',   "nosound",      &args.nosound,      "disable sound output"),
         OPT_BOOLEAN('\0',   "fullscreen",   &args.fullscreen,   "enable fullscreen mode"),
+        OPT_BOOLEAN('\0',   "precompile",   &args.precompile,   "store compiled code in saved carts"),
+        OPT_BOOLEAN('\0',   "trustbinary",  &args.trustbinary,  "run compiled code stored in loaded carts"),
         OPT_STRING('\0',    "fs",           &args.fs,           "path to the file system folder"),
         OPT_INTEGER('\0',   "scale",        &args.scale,        "main window scale"),
+        OPT_INTEGER('\0',   "latency",      &args.latency,      "audio latency in milliseconds"),
+        OPT_INTEGER('\0',   "gcbudget",     &args.gcbudget,     "script GC time per frame in microseconds, -1 to disable"),
 #if defined(CRT_SHADER_SUPPORT)
         OPT_BOOLEAN('\0',   "crt",          &args.crt,          "enable CRT monitor effect"),
 #endif
@@ -2084,14 +2079,23 @@ Studio* studioInit(s32 argc, const char **argv, s32 samplerate, const char* fold
     if(args.scale)
         impl.config->data.uiScale = args.scale;
 
+    if(args.latency)
+        impl.config->data.audioLatency = args.latency;
+
+    if(args.gcbudget)
+        impl.config->data.gcBudget = args.gcbudget;
+
 #if defined(CRT_SHADER_SUPPORT)
     impl.config->data.crtMonitor = args.crt;
 #endif
 
     impl.config->data.goFullscreen = args.fullscreen;
     impl.config->data.noSound = args.nosound;
+    impl.config->data.precompile = args.precompile;
+    impl.config->data.trustBinary = args.trustbinary;
 
     impl.studio.tick = studioTick;
+    impl.studio.idle = studioIdle;
     impl.studio.close = studioClose;
     impl.studio.updateProject = updateStudioProject;
     impl.studio.exit = exitStudio;
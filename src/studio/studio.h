@@ -33,6 +33,7 @@
 #include "defines.h"
 #include "tools.h"
 #include "system.h"
+#include "render.h"
 
 #define TIC_LOCAL ".local/"
 #define TIC_LOCAL_VERSION TIC_LOCAL TIC_VERSION_LABEL "/"
@@ -70,7 +71,11 @@ typedef struct
     bool skip;
     bool nosound;
     bool fullscreen;
+    bool precompile;
+    bool trustbinary;
     s32 scale;
+    s32 latency;
+    s32 gcbudget;
     const char *fs;
     const char *cart;
 #if defined(CRT_SHADER_SUPPORT)
@@ -181,6 +186,7 @@ bool hasProjectExt(const char* name);
 void sfx_stop(tic_mem* tic, s32 channel);
 const char* studioExportMusic(s32 track, const char* filename);
 const char* studioExportSfx(s32 sfx, const char* filename);
+s32 studioExportSoundtrack(const char* name, tic_render_progress progress, void* data);
 s32 calcWaveAnimation(tic_mem* tic, u32 index, s32 channel);
 void map2ram(tic_ram* ram, const tic_map* src);
 void tiles2ram(tic_ram* ram, const tic_tiles* src);
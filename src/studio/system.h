@@ -91,6 +91,9 @@ typedef struct
 
     void (*updateConfig)();
 
+    // audio output counters, NULL if the platform doesn't track them
+    void (*audioStats)(u32* underruns, u32* overruns, s32* latency);
+
 } System;
 
 typedef struct
@@ -160,6 +163,10 @@ typedef struct
     const tic_cartridge* cart;
 
     s32 uiScale;
+    s32 audioLatency;
+    s32 gcBudget; // us per frame, 0 is the default, negative disables
+    bool precompile; // store the compiled code in saved and exported carts
+    bool trustBinary; // run the compiled code of loaded carts, bytecode isn't verified
 
 } StudioConfig;
 
@@ -169,6 +176,7 @@ typedef struct
     bool quit;
 
     void (*tick)();
+    void (*idle)(s32 available);
     void (*exit)();
     void (*close)();
     void (*updateProject)();
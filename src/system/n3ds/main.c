@@ -456,7 +456,8 @@ void n3ds_sound_init(int sample_rate)
     float mix[12];
     int buffer_size;
 
-    platform.audio.samples = platform.studio->tic->samples.size / (TIC_STEREO_CHANNELS * sizeof(u16));
+    // the core produces a varying number of samples per frame, size the blocks for the largest
+    platform.audio.samples = TIC_FRAME_SAMPLES_MAX(sample_rate);
     buffer_size = platform.audio.samples * (TIC_STEREO_CHANNELS * sizeof(u16));
 
     platform.audio.buffer = linearAlloc(buffer_size * AUDIO_BLOCKS);
@@ -519,8 +520,12 @@ static void audio_update(void) {
 
     if (wave_buf->status == NDSP_WBUF_DONE) {
         u16 *audio_ptr = wave_buf->data_pcm16;
-        memcpy(audio_ptr, platform.studio->tic->samples.buffer, platform.audio.buffer_size);
-        DSP_FlushDataCache(audio_ptr, platform.audio.buffer_size);
+        const tic_mem *tic = platform.studio->tic;
+        int size = tic->samples.size < platform.audio.buffer_size ? tic->samples.size : platform.audio.buffer_size;
+
+        memcpy(audio_ptr, tic->samples.buffer, size);
+        DSP_FlushDataCache(audio_ptr, size);
+        wave_buf->nsamples = size / (TIC_STEREO_CHANNELS * sizeof(u16));
 
         ndspChnWaveBufAdd(0, wave_buf);
         platform.audio.curr_block = (platform.audio.curr_block + 1) % AUDIO_BLOCKS;
@@ -0,0 +1,220 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "audio.h"
+#include "tic80.h"
+
+#include <SDL.h>
+
+// The main thread pushes a frame of samples per tick into a single producer,
+// single consumer ring, the device callback pulls from it. The pushed audio
+// is resampled by a fraction of a percent to keep the buffered amount around
+// the target latency, which absorbs drift between the frame and audio clocks.
+
+enum
+{
+    Channels = 2,
+    RingSize = 1 << 14, // frames, power of two
+    RingMask = RingSize - 1,
+    DeviceSamples = 256,
+};
+
+#define MAX_RATE_DEVIATION 0.005
+#define RATE_GAIN 0.02
+#define LEVEL_SMOOTHING 0.1
+
+struct Audio
+{
+    SDL_AudioDeviceID device;
+    s32 freq;
+    s32 target;
+
+    s16 ring[RingSize][Channels];
+    SDL_atomic_t head; // written by pushAudio only
+    SDL_atomic_t tail; // written by the callback only
+
+    SDL_atomic_t underruns;
+    u32 overruns;
+    u32 stalls;
+
+    bool started;
+    double level;
+    double rate;
+    double phase;
+    s16 last[Channels];
+};
+
+static void audioCallback(void* userdata, Uint8* stream, int len)
+{
+    Audio* audio = (Audio*)userdata;
+    s16* out = (s16*)stream;
+
+    s32 frames = len / (s32)sizeof audio->ring[0];
+    u32 tail = (u32)SDL_AtomicGet(&audio->tail);
+    s32 available = (s32)((u32)SDL_AtomicGet(&audio->head) - tail);
+    s32 count = available < frames ? available : frames;
+
+    s32 first = RingSize - (s32)(tail & RingMask);
+    if (first > count) first = count;
+
+    SDL_memcpy(out, audio->ring[tail & RingMask], first * sizeof audio->ring[0]);
+    SDL_memcpy(out + first * Channels, audio->ring[0], (count - first) * sizeof audio->ring[0]);
+
+    if (count < frames)
+    {
+        SDL_memset(out + count * Channels, 0, (frames - count) * sizeof audio->ring[0]);
+        SDL_AtomicIncRef(&audio->underruns);
+    }
+
+    SDL_AtomicSet(&audio->tail, (int)(tail + count));
+}
+
+Audio* createAudio(s32 latency)
+{
+    Audio* audio = (Audio*)SDL_calloc(1, sizeof(Audio));
+
+    if (!audio) return NULL;
+
+    SDL_AudioSpec want =
+    {
+        .freq = TIC80_SAMPLERATE,
+        .format = AUDIO_S16SYS,
+        .channels = Channels,
+        .samples = DeviceSamples,
+        .callback = audioCallback,
+        .userdata = audio,
+    };
+
+    SDL_AudioSpec spec;
+
+    // format and channel conversions are left to SDL's audio thread
+    audio->device = SDL_OpenAudioDevice(NULL, 0, &want, &spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    audio->freq = audio->device ? spec.freq : want.freq;
+    audio->rate = 1.0;
+
+    setAudioLatency(audio, latency);
+
+    return audio;
+}
+
+void freeAudio(Audio* audio)
+{
+    if (audio->device)
+        SDL_CloseAudioDevice(audio->device);
+
+    SDL_free(audio);
+}
+
+s32 getAudioFreq(const Audio* audio)
+{
+    return audio->freq;
+}
+
+void setAudioLatency(Audio* audio, s32 latency)
+{
+    if (latency <= 0)
+        latency = AUDIO_LATENCY;
+
+    s32 target = (s32)((s64)audio->freq * latency / 1000);
+    audio->target = target < DeviceSamples ? DeviceSamples : target > RingSize / 4 ? RingSize / 4 : target;
+    audio->level = audio->target;
+}
+
+void getAudioStats(const Audio* audio, AudioStats* stats)
+{
+    s32 fill = (s32)((u32)SDL_AtomicGet((SDL_atomic_t*)&audio->head) - (u32)SDL_AtomicGet((SDL_atomic_t*)&audio->tail));
+
+    stats->underruns = (u32)SDL_AtomicGet((SDL_atomic_t*)&audio->underruns);
+    stats->overruns = audio->overruns;
+    stats->latency = (s32)((s64)fill * 1000 / audio->freq);
+    stats->rate = audio->rate;
+}
+
+static inline void writeFrame(Audio* audio, u32 pos, s32 left, s32 right)
+{
+    s16* frame = audio->ring[pos & RingMask];
+    frame[0] = left;
+    frame[1] = right;
+}
+
+void pushAudio(Audio* audio, const s16* samples, s32 count)
+{
+    s32 frames = count / Channels;
+
+    if (!audio->device || frames <= 0) return;
+
+    u32 head = (u32)SDL_AtomicGet(&audio->head);
+    s32 fill = (s32)(head - (u32)SDL_AtomicGet(&audio->tail));
+
+    // the callback ran dry after a stall, refill the ring at once instead of
+    // underrunning until the rate control catches up
+    u32 underruns = (u32)SDL_AtomicGet(&audio->underruns);
+    if (audio->started && underruns != audio->stalls)
+    {
+        audio->stalls = underruns;
+
+        for (; fill < audio->target - frames / 2; fill++)
+            writeFrame(audio, head++, audio->last[0], audio->last[1]);
+
+        audio->level = audio->target;
+    }
+
+    // steer the mean buffered amount to the target with a tiny pitch change
+    audio->level += (fill + frames / 2 - audio->level) * LEVEL_SMOOTHING;
+    double error = (audio->level - audio->target) / audio->target * RATE_GAIN;
+    audio->rate = 1.0 + (error < -MAX_RATE_DEVIATION ? -MAX_RATE_DEVIATION : error > MAX_RATE_DEVIATION ? MAX_RATE_DEVIATION : error);
+
+    s32 limit = audio->target * 2 + frames < RingSize ? audio->target * 2 + frames : RingSize;
+    s32 written = 0;
+    double pos = audio->phase;
+
+    // linear interpolation over the last frame of the previous push and this one
+    while (pos < frames)
+    {
+        if (fill + written >= limit)
+        {
+            audio->overruns++;
+            pos = frames;
+            break;
+        }
+
+        s32 i = (s32)pos;
+        double t = pos - i;
+        const s16* a = i ? samples + (i - 1) * Channels : audio->last;
+        const s16* b = samples + i * Channels;
+
+        writeFrame(audio, head + written++, (s32)(a[0] + (b[0] - a[0]) * t), (s32)(a[1] + (b[1] - a[1]) * t));
+
+        pos += audio->rate;
+    }
+
+    audio->phase = pos - frames;
+    SDL_memcpy(audio->last, samples + (frames - 1) * Channels, sizeof audio->last);
+
+    SDL_AtomicSet(&audio->head, (int)(head + written));
+
+    if (!audio->started && fill + written >= audio->target)
+    {
+        audio->started = true;
+        SDL_PauseAudioDevice(audio->device, 0);
+    }
+}
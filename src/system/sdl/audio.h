@@ -0,0 +1,49 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "tic80_types.h"
+
+// default amount of buffered audio, ms
+#define AUDIO_LATENCY 20
+
+typedef struct Audio Audio;
+
+typedef struct
+{
+    u32 underruns;
+    u32 overruns;
+    s32 latency;    // currently buffered, ms
+    double rate;    // last resampling ratio
+} AudioStats;
+
+// opens the default device for interleaved stereo s16, pulled from a ring buffer
+Audio* createAudio(s32 latency);
+void freeAudio(Audio* audio);
+
+s32 getAudioFreq(const Audio* audio);
+void setAudioLatency(Audio* audio, s32 latency);
+void getAudioStats(const Audio* audio, AudioStats* stats);
+
+// queue count samples (not frames), called once per tick from the main thread
+void pushAudio(Audio* audio, const s16* samples, s32 count);
@@ -23,6 +23,7 @@
 #include "studio/system.h"
 #include "tools.h"
 #include "ext/net.h"
+#include "audio.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -163,12 +164,7 @@ static struct
 
     Net* net;
 
-    struct
-    {
-        SDL_AudioSpec       spec;
-        SDL_AudioDeviceID   device;
-        SDL_AudioCVT        cvt;
-    } audio;
+    Audio* audio;
 } platform
 #if defined(TOUCH_INPUT_SUPPORT)
 = {
@@ -184,27 +180,6 @@ static inline bool crtMonitorEnabled()
 }
 #endif
 
-static void initSound()
-{
-    SDL_AudioSpec want =
-    {
-        .freq = TIC80_SAMPLERATE,
-        .format = AUDIO_S16,
-        .channels = TIC_STEREO_CHANNELS,
-        .userdata = NULL,
-    };
-
-    platform.audio.device = SDL_OpenAudioDevice(NULL, 0, &want, &platform.audio.spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-
-    SDL_BuildAudioCVT(&platform.audio.cvt, want.format, want.channels, platform.audio.spec.freq, platform.audio.spec.format, platform.audio.spec.channels, platform.audio.spec.freq);
-
-    if(platform.audio.cvt.needed)
-    {
-        platform.audio.cvt.len = platform.audio.spec.freq * platform.audio.spec.channels * sizeof(s16) / TIC80_FRAMERATE;
-        platform.audio.cvt.buf = SDL_malloc(platform.audio.cvt.len * platform.audio.cvt.len_mult);
-    }
-}
-
 static const u8* getSpritePtr(const tic_tile* tiles, s32 x, s32 y)
 {
     enum { SheetCols = (TIC_SPRITESHEET_SIZE / TIC_SPRITESIZE) };
@@ -1012,15 +987,7 @@ static void blitSound()
 {
     tic_mem* tic = platform.studio->tic;
 
-    SDL_PauseAudioDevice(platform.audio.device, 0);
-    
-    if(platform.audio.cvt.needed)
-    {
-        SDL_memcpy(platform.audio.cvt.buf, tic->samples.buffer, tic->samples.size);
-        SDL_ConvertAudio(&platform.audio.cvt);
-        SDL_QueueAudio(platform.audio.device, platform.audio.cvt.buf, platform.audio.cvt.len_cvt);
-    }
-    else SDL_QueueAudio(platform.audio.device, tic->samples.buffer, tic->samples.size);
+    pushAudio(platform.audio, tic->samples.buffer, tic->samples.size / sizeof(s16));
 }
 
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -1289,6 +1256,16 @@ static void showMessageBox(const char* title, const char* message)
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, title, message, NULL);
 }
 
+static void audioStats(u32* underruns, u32* overruns, s32* latency)
+{
+    AudioStats stats;
+    getAudioStats(platform.audio, &stats);
+
+    *underruns = stats.underruns;
+    *overruns = stats.overruns;
+    *latency = stats.latency;
+}
+
 static void setWindowTitle(const char* title)
 {
     if(platform.window)
@@ -1425,6 +1402,7 @@ static System systemInterface =
     .preseed = preseed,
     .poll = pollEvent,
     .updateConfig = updateConfig,
+    .audioStats = audioStats,
 
     .text = getInputText,
 };
@@ -1602,11 +1580,20 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK);
 
-    initSound();
+    platform.audio = createAudio(AUDIO_LATENCY);
+
+    if(!platform.audio)
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, TIC_TITLE, "Unable to create the audio output", NULL);
+        SDL_Quit();
+        return 1;
+    }
 
     platform.net = createNet();
 
-    platform.studio = studioInit(argc, argv, platform.audio.spec.freq, folder, &systemInterface);
+    platform.studio = studioInit(argc, argv, getAudioFreq(platform.audio), folder, &systemInterface);
+
+    setAudioLatency(platform.audio, platform.studio->config()->audioLatency);
 
     {
         const s32 Width = TIC80_FULLWIDTH * platform.studio->config()->uiScale;
@@ -1649,6 +1636,13 @@ static s32 start(s32 argc, const char **argv, const char* folder)
             {
                 s64 delay = nextTick - SDL_GetPerformanceCounter();
 
+                if(delay > 0)
+                {
+                    s64 spare = delay * 1000000 / SDL_GetPerformanceFrequency();
+                    platform.studio->idle((s32)spare);
+                    delay = nextTick - SDL_GetPerformanceCounter();
+                }
+
                 if(delay < 0)
                     nextTick -= delay;
                 else
@@ -1668,9 +1662,6 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 
     closeNet(platform.net);
 
-    if(platform.audio.cvt.buf)
-        SDL_free(platform.audio.cvt.buf);
-
     {
         destroyGPU();
 
@@ -1680,7 +1671,7 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 #endif    
 
         SDL_DestroyWindow(platform.window);
-        SDL_CloseAudioDevice(platform.audio.device);
+        freeAudio(platform.audio);
 
         for(s32 i = 0; i < COUNT_OF(platform.mouse.cursors); i++)
             SDL_FreeCursor(platform.mouse.cursors[i]);
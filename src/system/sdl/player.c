@@ -25,6 +25,8 @@
 #include <SDL.h>
 #include <tic80.h>
 
+#include "audio.h"
+
 #define TIC80_WINDOW_SCALE 3
 #define TIC80_WINDOW_TITLE "TIC-80"
 #define TIC80_DEFAULT_CART "cart.tic"
@@ -51,42 +53,23 @@ s32 runCart(void* cart, s32 size)
 	SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, TIC80_FULLWIDTH, TIC80_FULLHEIGHT);
 
-	SDL_AudioDeviceID audioDevice = 0;
-	SDL_AudioSpec audioSpec;
-	SDL_AudioCVT cvt;
-	bool audioStarted = false;
+	Audio* audio = createAudio(AUDIO_LATENCY);
 	s32 output = 0;
 
-	{
-		SDL_AudioSpec want =
-		{
-			.freq = TIC80_SAMPLERATE,
-			.format = AUDIO_S16,
-			.channels = 2,
-			.userdata = NULL,
-		};
-
-		audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-
-		SDL_BuildAudioCVT(&cvt, want.format, want.channels, audioSpec.freq, audioSpec.format, audioSpec.channels, audioSpec.freq);
-
-		if (cvt.needed)
-		{
-			cvt.len = audioSpec.freq * audioSpec.channels * sizeof(s16) / TIC80_FRAMERATE;
-			cvt.buf = SDL_malloc(cvt.len * cvt.len_mult);
-		}
-	}
-
 	tic80_input input;
 	SDL_memset(&input, 0, sizeof input);
 
-	tic80* tic = tic80_create(audioSpec.freq);
-	tic->callback.exit = onExit;
-	tic80_load(tic, cart, size);
+	tic80* tic = audio ? tic80_create(getAudioFreq(audio)) : NULL;
+
+	if(tic)
+	{
+		tic->callback.exit = onExit;
+		tic80_load(tic, cart, size);
+	}
 
 	if(!tic)
 	{
-		fprintf(stderr, "Failed to load cart data.");
+		fprintf(stderr, audio ? "Failed to load cart data." : "Failed to create audio output.");
 		output = 1;
 	}
 	else {
@@ -144,22 +127,7 @@ s32 runCart(void* cart, s32 size)
 
 			tic80_tick(tic, &input);
 
-			if (!audioStarted && audioDevice)
-				audioStarted = true;
-
-			SDL_PauseAudioDevice(audioDevice, 0);
-
-			{
-				s32 size = tic->sound.count * sizeof(tic->sound.samples[0]);
-
-				if (cvt.needed)
-				{
-					SDL_memcpy(cvt.buf, tic->sound.samples, size);
-					SDL_ConvertAudio(&cvt);
-					SDL_QueueAudio(audioDevice, cvt.buf, cvt.len_cvt);
-				}
-				else SDL_QueueAudio(audioDevice, tic->sound.samples, size);
-			}
+			pushAudio(audio, tic->sound.samples, tic->sound.count);
 
 			SDL_RenderClear(renderer);
 
@@ -192,6 +160,13 @@ s32 runCart(void* cart, s32 size)
 			{
 				s64 delay = nextTick - SDL_GetPerformanceCounter();
 
+				if (delay > 0)
+				{
+					s64 spare = delay * 1000000 / SDL_GetPerformanceFrequency();
+					tic80_idle(tic, spare < TIC80_IDLE_BUDGET ? (s32)spare : TIC80_IDLE_BUDGET);
+					delay = nextTick - SDL_GetPerformanceCounter();
+				}
+
 				if (delay < 0)
 					nextTick -= delay;
 				else SDL_Delay((u32)(delay * 1000 / SDL_GetPerformanceFrequency()));
@@ -204,7 +179,9 @@ s32 runCart(void* cart, s32 size)
 	SDL_DestroyTexture(texture);
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
-	SDL_CloseAudioDevice(audioDevice);
+
+	if(audio)
+		freeAudio(audio);
 
 	SDL_free(cart);
 	return output;
@@ -3,7 +3,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
 
 #include <tic80.h>
 
@@ -33,7 +32,7 @@ static void app_init(void)
         if(cart)
         {
             printf("%s\n", "cart loaded");
-            tic = tic80_create(saudio_sample_rate());
+            tic = tic80_create_format(saudio_sample_rate(), TIC80_SAMPLE_FORMAT_F32);
 
             if(tic)
             {
@@ -57,12 +56,7 @@ static void app_frame(void)
 
     sokol_gfx_draw(tic->screen);
 
-    static float floatSamples[TIC80_SAMPLERATE / TIC80_FRAMERATE * 2];
-
-    for(s32 i = 0; i < tic->sound.count; i++)
-        floatSamples[i] = (float)tic->sound.samples[i] / SHRT_MAX;
-
-    saudio_push(floatSamples, tic->sound.count / 2);
+    saudio_push(tic->sound.fsamples, tic->sound.count / 2);
 }
 
 static void app_input(const sapp_event* event)
@@ -172,7 +172,7 @@ static void app_init(void)
 
     stm_setup();
 
-    platform.audio.samples = calloc(sizeof platform.audio.samples[0], saudio_sample_rate() / TIC80_FRAMERATE * TIC_STEREO_CHANNELS);
+    platform.audio.samples = calloc(sizeof platform.audio.samples[0], TIC_FRAME_SAMPLES_MAX(saudio_sample_rate()) * TIC_STEREO_CHANNELS);
 }
 
 static void handleKeyboard()
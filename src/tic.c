@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include <tic80.h>
 #include "api.h"
@@ -66,6 +67,11 @@ static u64 getCounter(void* data)
 }
 
 tic80* tic80_create(s32 samplerate)
+{
+    return tic80_create_format(samplerate, TIC80_SAMPLE_FORMAT_S16);
+}
+
+tic80* tic80_create_format(s32 samplerate, tic80_sample_format format)
 {
     tic80_local* tic80 = malloc(sizeof(tic80_local));
 
@@ -75,6 +81,19 @@ tic80* tic80_create(s32 samplerate)
 
         tic80->memory = tic_core_create(samplerate);
         tic80->tic.screen_format = tic80->memory->screen_format;
+        tic80->tic.sound.format = format;
+
+        if(format == TIC80_SAMPLE_FORMAT_F32)
+        {
+            tic80->fsamples = calloc(TIC_FRAME_SAMPLES_MAX(samplerate) * TIC_STEREO_CHANNELS, sizeof(float));
+
+            if(!tic80->fsamples)
+            {
+                tic_core_close(tic80->memory);
+                free(tic80);
+                return NULL;
+            }
+        }
 
         return &tic80->tic;
     }
@@ -82,12 +101,28 @@ tic80* tic80_create(s32 samplerate)
     return NULL;
 }
 
+static void updateSound(tic80_local* tic80)
+{
+    const tic_mem* memory = tic80->memory;
+    s32 count = memory->samples.size / sizeof(s16);
+
+    tic80->tic.sound.count = count;
+
+    if(tic80->tic.sound.format == TIC80_SAMPLE_FORMAT_F32)
+    {
+        for(s32 i = 0; i < count; i++)
+            tic80->fsamples[i] = (float)memory->samples.buffer[i] / SHRT_MAX;
+
+        tic80->tic.sound.fsamples = tic80->fsamples;
+    }
+    else tic80->tic.sound.samples = memory->samples.buffer;
+}
+
 TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
 {
     tic80_local* tic80 = (tic80_local*)tic;
 
-    tic80->tic.sound.count = tic80->memory->samples.size/sizeof(s16);
-    tic80->tic.sound.samples = tic80->memory->samples.buffer;
+    updateSound(tic80);
 
     tic80->tic.screen = tic80->memory->screen;
 
@@ -120,16 +155,26 @@ TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
     tic_core_tick(tic80->memory, &tic80->tickData);
     tic_core_tick_end(tic80->memory);
 
+    updateSound(tic80);
+
     tic_core_blit(tic80->memory, tic80->memory->screen_format);
 
     tic80->tick_counter++;
 }
 
+TIC80_API void tic80_idle(tic80* tic, s32 budget)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic_core_idle(tic80->memory, budget);
+}
+
 TIC80_API void tic80_delete(tic80* tic)
 {
     tic80_local* tic80 = (tic80_local*)tic;
 
     tic_core_close(tic80->memory);
 
+    free(tic80->fsamples);
     free(tic80);
 }
@@ -98,6 +98,8 @@
 
 #define TIC_CODE_BANK_SIZE (64 * 1024) // 64K
 #define TIC_CODE_SIZE (TIC_CODE_BANK_SIZE * TIC_BANKS)
+#define TIC_BINARY_BANK_SIZE (32 * 1024) // 32K
+#define TIC_BINARY_SIZE (TIC_BINARY_BANK_SIZE * TIC_BANKS)
 
 #define TIC_GAMEPADS (sizeof(tic80_gamepads) / sizeof(tic80_gamepad))
 
@@ -376,6 +378,23 @@ typedef union
     } banks[TIC_BANKS];
 } tic_code;
 
+// precompiled code, the header is followed by the zipped script VM binary
+typedef struct
+{
+    u32 hash;   // tic_tool_crc32 of the code it was compiled from
+    u32 size;   // unzipped size
+} tic_binary_header;
+
+typedef struct
+{
+    s32 size;
+    u8 data[TIC_BINARY_SIZE];
+
+    // built or cached by this TIC, or trusted explicitly, the VMs don't verify bytecode
+    // and only load a trusted binary, a binary read from a cart starts untrusted
+    bool trusted;
+} tic_binary;
+
 typedef struct 
 {
     s32 size;
@@ -432,6 +451,7 @@ typedef struct
     };
 
     tic_code code;
+    tic_binary binary;
     tic_cover_image cover;
 } tic_cartridge;
 
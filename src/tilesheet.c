@@ -25,6 +25,10 @@
 
 #include <stdlib.h>
 
+#if defined(TIC_BUILD_WITH_THREADS)
+#include <pthread.h>
+#endif
+
 static const tic_blit_segment segments[] = {
     //   +page +nb_pages 
     //   |  +bank +bank_size
@@ -55,15 +59,31 @@ extern void tic_tilesheet_setpix(const tic_tilesheet* sheet, s32 x, s32 y, u8 va
 extern u8 tic_tilesheet_gettilepix(const tic_tileptr* tile, s32 x, s32 y);
 extern void tic_tilesheet_settilepix(const tic_tileptr* tile, s32 x, s32 y, u8 value);
 
-tic_tilesheet tic_tilesheet_get(u8 segment, u8* ptr)
+typedef struct
 {
-    return (tic_tilesheet) { &segments[segment], ptr };
-}
+    u16 ptr;
+    u8 offset;
+} TileEntry;
 
-tic_tileptr tic_tilesheet_gettile(const tic_tilesheet* sheet, s32 index, bool local)
+enum
+{
+    SegmentsCount = COUNT_OF(segments),
+    LocalTiles = TIC_SPRITESHEET_COLS * TIC_SPRITESHEET_COLS,
+    // two banks of every segment: 4 x 256, 4 x 512 and 8 x 1024 tiles
+    GlobalTiles = 2 * (4 * 256 + 4 * 512 + 8 * 1024),
+};
+
+// (segment, index) -> tile location, global indices wrap every 2 banks
+static struct
+{
+    TileEntry local[SegmentsCount][LocalTiles];
+    TileEntry global[GlobalTiles];
+    u16 base[SegmentsCount];
+} tables;
+
+static void calcTile(const tic_blit_segment* segment, s32 index, bool local, u32* ptr_offset, u32* offset)
 {
     enum { Cols = 16, Size = 8 };
-    const tic_blit_segment* segment = sheet->segment;
 
     s32 bank, page, iy, ix;
     if (local) {
@@ -86,11 +106,75 @@ tic_tileptr tic_tilesheet_gettile(const tic_tilesheet* sheet, s32 index, bool lo
     }
 
     div_t xdiv = div(ix, segment->nb_pages);    // xbuffer, xoffset
-    u32 ptr_offset = (bank * Cols + iy) * Cols + page * Cols / segment->nb_pages + xdiv.quot;
-    u8* ptr = sheet->ptr + segment->ptr_size * ptr_offset;
-    u32 offset = (xdiv.rem * Size);
+    *ptr_offset = (bank * Cols + iy) * Cols + page * Cols / segment->nb_pages + xdiv.quot;
+    *offset = (xdiv.rem * Size);
+}
+
+static void initTables()
+{
+    for (s32 s = 0, base = 0; s < SegmentsCount; s++)
+    {
+        const tic_blit_segment* segment = &segments[s];
+        u32 ptr_offset, offset;
+
+        for (s32 i = 0; i < LocalTiles; i++)
+        {
+            calcTile(segment, i, true, &ptr_offset, &offset);
+            tables.local[s][i] = (TileEntry){ segment->ptr_size * ptr_offset, offset };
+        }
+
+        tables.base[s] = base;
+        for (s32 i = 0; i < segment->bank_size * 2; i++)
+        {
+            calcTile(segment, i, false, &ptr_offset, &offset);
+            tables.global[base + i] = (TileEntry){ segment->ptr_size * ptr_offset, offset };
+        }
+
+        base += segment->bank_size * 2;
+    }
+}
+
+// cores are created on worker threads by the offline renderer,
+// the first one to get here builds the tables for all of them
+void tic_tilesheet_init()
+{
+#if defined(TIC_BUILD_WITH_THREADS)
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, initTables);
+#else
+    static bool ready = false;
+
+    if (!ready)
+    {
+        initTables();
+        ready = true;
+    }
+#endif
+}
+
+tic_tilesheet tic_tilesheet_get(u8 segment, u8* ptr)
+{
+    return (tic_tilesheet) { &segments[segment], ptr };
+}
+
+tic_tileptr tic_tilesheet_gettile(const tic_tilesheet* sheet, s32 index, bool local)
+{
+    const tic_blit_segment* segment = sheet->segment;
+    s32 id = (s32)(segment - segments);
+
+    const TileEntry* entry;
+    if (local)
+        entry = &tables.local[id][index & (LocalTiles - 1)];
+    else if (index >= 0)
+        entry = &tables.global[tables.base[id] + (index & (segment->bank_size * 2 - 1))];
+    else
+    {
+        u32 ptr_offset, offset;
+        calcTile(segment, index, local, &ptr_offset, &offset);
+        return (tic_tileptr) { segment, offset, sheet->ptr + segment->ptr_size * ptr_offset };
+    }
 
-    return (tic_tileptr) { segment, offset, ptr };
+    return (tic_tileptr) { segment, entry->offset, sheet->ptr + entry->ptr };
 }
 
 extern s32 tic_blit_calc_segment(const tic_blit* blit);
@@ -51,6 +51,7 @@ typedef struct
     u8* ptr;
 } tic_tileptr;
 
+void tic_tilesheet_init();
 tic_tilesheet tic_tilesheet_get(u8 segment, u8* ptr);
 tic_tileptr tic_tilesheet_gettile(const tic_tilesheet* sheet, s32 index, bool local);
 
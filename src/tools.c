@@ -155,11 +155,12 @@ void tic_tool_set_track_row_sfx(tic_track_row* row, s32 sfx)
 
 bool tic_tool_is_noise(const tic_waveform* wave)
 {
-    for(s32 i = 0; i < WAVE_SIZE; i++)
-        if(wave->data[i])
-            return false;
+    STATIC_ASSERT(wave_size, WAVE_SIZE == sizeof(u64) * 2);
 
-    return true;
+    u64 data[2];
+    memcpy(data, wave->data, sizeof data);
+
+    return (data[0] | data[1]) == 0;
 }
 
 void tic_tool_str2buf(const char* str, s32 size, void* buf, bool flip)
@@ -195,3 +196,54 @@ u32 tic_tool_unzip(void* dest, s32 destSize, const void* source, s32 size)
     unsigned long destSizeLong = destSize;
     return uncompress(dest, &destSizeLong, source, size) == Z_OK ? destSizeLong : 0;
 }
+
+u32 tic_tool_crc32(const void* data, s32 size)
+{
+    return (u32)crc32(crc32(0, Z_NULL, 0), data, size);
+}
+
+bool tic_tool_pack_binary(tic_binary* binary, const char* code, const void* data, s32 size)
+{
+    tic_binary_header header = {tic_tool_crc32(code, (s32)strlen(code)), size};
+    s32 zipped = tic_tool_zip(binary->data + sizeof header, sizeof binary->data - sizeof header, data, size);
+
+    binary->size = zipped ? sizeof header + zipped : 0;
+
+    if(zipped)
+        memcpy(binary->data, &header, sizeof header);
+
+    return zipped > 0;
+}
+
+bool tic_tool_binary_matches(const tic_binary* binary, const char* code)
+{
+    tic_binary_header header;
+
+    if(binary->size <= (s32)sizeof header)
+        return false;
+
+    memcpy(&header, binary->data, sizeof header);
+
+    return header.hash == tic_tool_crc32(code, (s32)strlen(code));
+}
+
+void* tic_tool_unpack_binary(const tic_binary* binary, const char* code, s32* size)
+{
+    tic_binary_header header;
+
+    if(!tic_tool_binary_matches(binary, code))
+        return NULL;
+
+    memcpy(&header, binary->data, sizeof header);
+
+    u8* data = malloc(header.size);
+
+    if(data && tic_tool_unzip(data, header.size, binary->data + sizeof header, binary->size - sizeof header) == header.size)
+    {
+        *size = header.size;
+        return data;
+    }
+
+    free(data);
+    return NULL;
+}
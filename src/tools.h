@@ -87,3 +87,9 @@ void    tic_tool_str2buf(const char* str, s32 size, void* buf, bool flip);
 
 u32     tic_tool_zip(void* dest, s32 destSize, const void* source, s32 size);
 u32     tic_tool_unzip(void* dest, s32 bufSize, const void* source, s32 size);
+u32     tic_tool_crc32(const void* data, s32 size);
+
+// the unpacked binary is malloc'ed, NULL when it was compiled from another code
+bool    tic_tool_pack_binary(tic_binary* binary, const char* code, const void* data, s32 size);
+bool    tic_tool_binary_matches(const tic_binary* binary, const char* code);
+void*   tic_tool_unpack_binary(const tic_binary* binary, const char* code, s32* size);
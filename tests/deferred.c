@@ -0,0 +1,299 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Renders random call sequences immediately and deferred, with several band
+// counts, and checks that the VRAM, the depth buffer and every value the
+// calls returned are the same.
+
+#include "core/core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define SEQUENCES 200
+#define MAX_CALLS 400
+#define MAX_RESULTS (MAX_CALLS * 2)
+
+// mesh data lives in the sfx/music RAM, drawing doesn't read it otherwise
+#define MESH_VERTICES offsetof(tic_ram, music)
+#define MESH_INDICES (MESH_VERTICES + 64 * TIC_MESH_VERTEX_SIZE)
+#define MESH_UVS (MESH_INDICES + 64 * TIC_MESH_TRIANGLE_SIZE)
+
+typedef struct
+{
+    u8 screen[sizeof(((tic_vram*)0)->screen)];
+    s32 depth[TIC80_WIDTH * TIC80_HEIGHT];
+    s32 results[MAX_RESULTS];
+    s32 count;
+} Frame;
+
+static u32 Seed;
+
+static u32 rnd()
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static s32 range(s32 min, s32 max)
+{
+    return min + (s32)(rnd() % (u32)(max - min + 1));
+}
+
+static float rangef(float min, float max)
+{
+    return min + (max - min) * (rnd() & 0xffff) / 65535.0f;
+}
+
+static void fillRandom(u8* data, s32 size)
+{
+    for (s32 i = 0; i < size; i++)
+        data[i] = rnd();
+}
+
+static void initMemory(tic_mem* tic)
+{
+    tic_core* core = (tic_core*)tic;
+
+    tic_api_reset(tic);
+
+    fillRandom(tic->ram.vram.screen.data, sizeof tic->ram.vram.screen);
+    fillRandom((u8*)&tic->ram.tiles, sizeof tic->ram.tiles);
+    fillRandom((u8*)&tic->ram.sprites, sizeof tic->ram.sprites);
+    fillRandom((u8*)&tic->ram.map, sizeof tic->ram.map);
+    fillRandom((u8*)&tic->ram.font, sizeof tic->ram.font);
+
+    u8* ram = (u8*)&tic->ram;
+
+    for (s32 i = 0; i < 64; i++)
+    {
+        u8* vert = ram + MESH_VERTICES + i * TIC_MESH_VERTEX_SIZE;
+        s16 values[] = { range(-40, 280), range(-40, 176), range(-100, 100) };
+        memcpy(vert, values, sizeof values);
+
+        u8* uv = ram + MESH_UVS + i * TIC_MESH_UV_SIZE;
+        s16 uvs[] = { range(-64, 320), range(-64, 320) };
+        memcpy(uv, uvs, sizeof uvs);
+
+        u8* tri = ram + MESH_INDICES + i * TIC_MESH_TRIANGLE_SIZE;
+        u16 indices[] = { range(0, 63), range(0, 63), range(0, 63) };
+        memcpy(tri, indices, sizeof indices);
+    }
+
+    memset(core->depth, 0x7f, sizeof core->depth);
+}
+
+static void result(Frame* frame, s32 value)
+{
+    if (frame->count < MAX_RESULTS)
+        frame->results[frame->count++] = value;
+}
+
+static void randomCall(tic_mem* tic, Frame* frame)
+{
+    u8 colors[] = { range(0, 15), range(0, 15), range(0, 15) };
+    s32 count = range(0, 3);
+    u8 color = range(0, 15);
+
+    // calls that read or write the memory flush the recorded ones, keep them
+    // rare enough for long recordings
+    switch (range(0, 7) ? range(0, 16) : range(17, 24))
+    {
+    case 0:
+        if (range(0, 3) == 0)
+            tic_api_cls(tic, color);
+        break;
+    case 1:
+        tic_api_pix(tic, range(-10, 250), range(-10, 146), color, false);
+        break;
+    case 2:
+        tic_api_line(tic, range(-100, 340), range(-100, 236), range(-100, 340), range(-100, 236), color);
+        break;
+    case 3:
+        tic_api_rect(tic, range(-40, 240), range(-40, 136), range(-10, 120), range(-10, 80), color);
+        break;
+    case 4:
+        tic_api_rectb(tic, range(-40, 240), range(-40, 136), range(-10, 120), range(-10, 80), color);
+        break;
+    case 5:
+        tic_api_circ(tic, range(-40, 280), range(-40, 176), range(-2, 80), color);
+        break;
+    case 6:
+        tic_api_circb(tic, range(-40, 280), range(-40, 176), range(-2, 80), color);
+        break;
+    case 7:
+        tic_api_elli(tic, range(-40, 280), range(-40, 176), range(-2, 90), range(-2, 60), color);
+        break;
+    case 8:
+        tic_api_ellib(tic, range(-40, 280), range(-40, 176), range(-2, 90), range(-2, 60), color);
+        break;
+    case 9:
+        tic_api_tri(tic, range(-60, 300), range(-60, 196), range(-60, 300), range(-60, 196), range(-60, 300), range(-60, 196), color);
+        break;
+    case 10:
+        tic_api_textri(tic,
+            rangef(-60, 300), rangef(-60, 196), rangef(-60, 300), rangef(-60, 196), rangef(-60, 300), rangef(-60, 196),
+            rangef(-64, 320), rangef(-64, 320), rangef(-64, 320), rangef(-64, 320), rangef(-64, 320), rangef(-64, 320),
+            range(0, 1), colors, count, rangef(0.5f, 4), rangef(0.5f, 4), rangef(0.5f, 4), range(0, 1));
+        break;
+    case 11:
+        tic_api_mesh(tic, MESH_VERTICES, MESH_INDICES, range(0, 64), color, range(0, 7),
+            range(0, 1) ? MESH_UVS : -1, range(0, 1), colors, count);
+        break;
+    case 12:
+        tic_api_spr(tic, range(0, 511), range(-40, 250), range(-40, 146), range(1, 3), range(1, 3), colors, count, range(1, 3), range(0, 3), range(0, 3));
+        break;
+    case 13:
+        {
+            u8 records[8 * TIC_SPRITE_RECORD_SIZE];
+            fillRandom(records, sizeof records);
+
+            // scale and size in tiles
+            for (u8* rec = records; rec != records + sizeof records; rec += TIC_SPRITE_RECORD_SIZE)
+                rec[7] &= 3, rec[10] &= 3, rec[11] &= 3;
+
+            tic_api_sprs(tic, records, sizeof records, range(0, 8));
+        }
+        break;
+    case 14:
+        tic_api_map(tic, range(0, 239), range(0, 135), range(1, 31), range(1, 18), range(-40, 40), range(-40, 40), colors, count, range(1, 2), NULL, NULL);
+        break;
+    case 15:
+        {
+            char text[16];
+            for (s32 i = 0, size = range(0, 15); i <= size; i++)
+                text[i] = i == size ? '\0' : range(0, 2) ? range(' ', '~') : '\n';
+
+            result(frame, tic_api_print(tic, text, range(-40, 240), range(-20, 136), range(0, 9) ? color : 255, range(0, 1), range(1, 3), range(0, 1)));
+            result(frame, tic_api_font(tic, text, range(-40, 240), range(-20, 136), color, range(4, 9), range(4, 9), range(0, 1), range(1, 2), range(0, 1)));
+        }
+        break;
+    case 16:
+        if (range(0, 2))
+            tic_api_clip(tic, range(-20, 200), range(-20, 120), range(0, 240), range(0, 136));
+        else
+            tic_api_clip(tic, 0, 0, TIC80_WIDTH, TIC80_HEIGHT);
+        break;
+    case 17:
+        result(frame, tic_api_pix(tic, range(-10, 250), range(-10, 146), 0, true));
+        break;
+    case 18:
+        // palette mapping and blit segment
+        if (range(0, 1))
+            tic_api_poke4(tic, offsetof(tic_ram, vram.mapping) * 2 + range(0, 15), color);
+        else
+            tic_api_poke(tic, offsetof(tic_ram, vram.vars) + 4, range(0, 15));
+        break;
+    case 19:
+        tic_api_mset(tic, range(0, 239), range(0, 135), range(0, 255));
+        break;
+    case 20:
+        tic_api_poke(tic, offsetof(tic_ram, tiles) + range(0, sizeof(tic_tiles) * 2 - 1), rnd());
+        break;
+    case 21:
+        // low bytes only, the coordinates stay near the screen
+        tic_api_poke(tic, MESH_VERTICES + range(0, 64 * TIC_MESH_VERTEX_SIZE / 2 - 1) * 2, rnd());
+        break;
+    case 22:
+        result(frame, tic_api_peek(tic, range(0, sizeof(tic->ram.vram.screen) - 1)));
+        break;
+    case 23:
+        tic_api_memcpy(tic, range(0, 4000), offsetof(tic_ram, tiles) + range(0, 4000), range(0, 4000));
+        break;
+    case 24:
+        tic_api_poke(tic, offsetof(tic_ram, font) + range(0, sizeof(tic_font) - 1), rnd());
+        break;
+    }
+}
+
+static void render(tic_mem* tic, Frame* frame, u32 seed, s32 calls, bool deferred)
+{
+    tic_core* core = (tic_core*)tic;
+
+    Seed = seed;
+    initMemory(tic);
+    frame->count = 0;
+
+    if (deferred)
+        tic_deferred_begin(tic);
+
+    for (s32 i = 0; i < calls; i++)
+        randomCall(tic, frame);
+
+    if (deferred)
+        tic_deferred_end(tic);
+
+    memcpy(frame->screen, tic->ram.vram.screen.data, sizeof frame->screen);
+    memcpy(frame->depth, core->depth, sizeof frame->depth);
+}
+
+static bool compare(const Frame* expected, const Frame* actual, u32 seed, s32 bands)
+{
+    if (memcmp(expected->screen, actual->screen, sizeof expected->screen) != 0)
+        printf("seed %u, %d bands: VRAM differs\n", seed, bands);
+    else if (memcmp(expected->depth, actual->depth, sizeof expected->depth) != 0)
+        printf("seed %u, %d bands: depth buffer differs\n", seed, bands);
+    else if (expected->count != actual->count
+        || memcmp(expected->results, actual->results, expected->count * sizeof(s32)) != 0)
+        printf("seed %u, %d bands: returned values differ\n", seed, bands);
+    else return true;
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    static const s32 Bands[] = { 1, 2, 3, 8 };
+
+    static Frame expected, actual;
+
+    tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+    tic_core* core = (tic_core*)tic;
+    s32 failed = 0;
+
+    for (s32 b = 0; b < COUNT_OF(Bands); b++)
+    {
+        tic_deferred_close(core->deferred);
+        core->deferred = tic_deferred_create(tic, Bands[b]);
+
+        for (u32 seed = 1; seed <= SEQUENCES; seed++)
+        {
+            s32 calls = seed % 4 == 0 ? MAX_CALLS : (s32)(seed % 50);
+
+            render(tic, &expected, seed, calls, false);
+            render(tic, &actual, seed, calls, true);
+
+            if (!compare(&expected, &actual, seed, Bands[b]))
+                failed++;
+        }
+    }
+
+    tic_core_close(tic);
+
+    printf("%d of %d sequences differ\n", failed, SEQUENCES * (s32)COUNT_OF(Bands));
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Runs random peekbuf/pokebuf/memcpy4/memset4 calls on the RAM and the same
+// calls as plain nibble loops on a copy of it, odd nibble ends, overlapping
+// ranges and out of range arguments included, and checks that both agree.
+// The time each side took is printed.
+
+#include "core/core.h"
+#include "tools.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CALLS 200000
+#define CHECK_PERIOD 1000
+#define RAM_NIBBLES (TIC_RAM_SIZE * 2)
+
+typedef struct
+{
+    s32 type;
+    s32 dst;
+    s32 src;
+    s32 size;
+    u8 val;
+} Call;
+
+static u32 Seed;
+
+static u32 rnd()
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static s32 range(s32 min, s32 max)
+{
+    return min + (s32)(rnd() % (u32)(max - min + 1));
+}
+
+static bool inRange(s32 address, s32 size, s32 limit)
+{
+    return size >= 0 && size <= limit && address >= 0 && address <= limit - size;
+}
+
+// mostly short runs with any alignment, some long and some out of range
+static s32 randomSize()
+{
+    switch (range(0, 15))
+    {
+    case 0: return range(-4, -1);
+    case 1: return range(1024, 16384);
+    case 2: return 0;
+    default: return range(1, 64);
+    }
+}
+
+static s32 randomAddress(s32 limit, s32 size)
+{
+    switch (range(0, 15))
+    {
+    case 0: return range(-4, -1);
+    case 1: return limit - size + range(-2, 2);
+    default: return range(0, limit - 1);
+    }
+}
+
+static Call randomCall()
+{
+    Call call = {range(0, 3)};
+
+    call.size = randomSize();
+    call.val = rnd();
+
+    s32 limit = call.type < 2 ? TIC_RAM_SIZE : RAM_NIBBLES;
+    call.dst = randomAddress(limit, call.size);
+
+    // a third of the copies overlap their source
+    call.src = range(0, 2)
+        ? randomAddress(limit, call.size)
+        : call.dst + range(-call.size, call.size);
+
+    return call;
+}
+
+static bool run(tic_mem* tic, const Call* call, u8* buffer)
+{
+    switch (call->type)
+    {
+    case 0: return tic_api_peekbuf(tic, call->dst, buffer, call->size);
+    case 1: return tic_api_pokebuf(tic, call->dst, buffer, call->size);
+    case 2: tic_api_memcpy4(tic, call->dst, call->src, call->size); break;
+    case 3: tic_api_memset4(tic, call->dst, call->val, call->size); break;
+    }
+
+    return true;
+}
+
+static bool runLoop(u8* ram, const Call* call, u8* buffer)
+{
+    static u8 nibbles[RAM_NIBBLES];
+
+    switch (call->type)
+    {
+    case 0:
+        if (!inRange(call->dst, call->size, TIC_RAM_SIZE)) return false;
+        for (s32 i = 0; i < call->size; i++)
+            buffer[i] = ram[call->dst + i];
+        break;
+    case 1:
+        if (!inRange(call->dst, call->size, TIC_RAM_SIZE)) return false;
+        for (s32 i = 0; i < call->size; i++)
+            ram[call->dst + i] = buffer[i];
+        break;
+    case 2:
+        if (!inRange(call->dst, call->size, RAM_NIBBLES) || !inRange(call->src, call->size, RAM_NIBBLES)) break;
+        for (s32 i = 0; i < call->size; i++)
+            nibbles[i] = tic_tool_peek4(ram, call->src + i);
+        for (s32 i = 0; i < call->size; i++)
+            tic_tool_poke4(ram, call->dst + i, nibbles[i]);
+        break;
+    case 3:
+        if (!inRange(call->dst, call->size, RAM_NIBBLES)) break;
+        for (s32 i = 0; i < call->size; i++)
+            tic_tool_poke4(ram, call->dst + i, call->val);
+        break;
+    }
+
+    return true;
+}
+
+// the bytes a call can write, the whole RAM is compared now and then
+static bool sameTouched(const u8* ram, const u8* expected, const Call* call)
+{
+    s32 from = call->dst, size = call->size;
+
+    if (call->type >= 2)
+    {
+        from >>= 1;
+        size = (size + 3) >> 1;
+    }
+
+    from = MIN(MAX(from, 0), TIC_RAM_SIZE);
+    size = MIN(MAX(size, 0), TIC_RAM_SIZE - from);
+
+    return memcmp(ram + from, expected + from, size) == 0;
+}
+
+static const char* callName(const Call* call)
+{
+    static const char* Names[] = {"peekbuf", "pokebuf", "memcpy4", "memset4"};
+    return Names[call->type];
+}
+
+int main(int argc, char** argv)
+{
+    static u8 expected[TIC_RAM_SIZE];
+    static u8 buffer[TIC_RAM_SIZE], expectedBuffer[TIC_RAM_SIZE];
+
+    tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+    u8* ram = (u8*)&tic->ram;
+
+    Seed = 1;
+    for (s32 i = 0; i < TIC_RAM_SIZE; i++)
+        expected[i] = ram[i] = rnd();
+
+    s32 failed = 0;
+    clock_t apiTime = 0, loopTime = 0;
+
+    for (s32 i = 0; i < CALLS; i++)
+    {
+        Call call = randomCall();
+
+        if (call.type == 1)
+            for (s32 b = 0; b < call.size; b++)
+                buffer[b] = expectedBuffer[b] = rnd();
+
+        clock_t start = clock();
+        bool done = run(tic, &call, buffer);
+        apiTime += clock() - start;
+
+        start = clock();
+        bool expectedDone = runLoop(expected, &call, expectedBuffer);
+        loopTime += clock() - start;
+
+        bool same = done == expectedDone
+            && (call.type != 0 || !done || memcmp(buffer, expectedBuffer, call.size) == 0)
+            && sameTouched(ram, expected, &call)
+            && ((i + 1) % CHECK_PERIOD || memcmp(ram, expected, TIC_RAM_SIZE) == 0);
+
+        if (!same)
+        {
+            printf("call %d: %s(%d, %d, %d) differs\n", i, callName(&call), call.dst, call.type == 3 ? call.val : call.src, call.size);
+            memcpy(expected, ram, TIC_RAM_SIZE);
+            failed++;
+        }
+    }
+
+    if (memcmp(ram, expected, TIC_RAM_SIZE) != 0)
+    {
+        printf("RAM differs after the last call\n");
+        failed++;
+    }
+
+    tic_core_close(tic);
+
+    printf("%d calls: %.1f ms, nibble loops: %.1f ms\n", CALLS,
+        apiTime * 1000.0 / CLOCKS_PER_SEC, loopTime * 1000.0 / CLOCKS_PER_SEC);
+    printf("%d of %d calls differ\n", failed, CALLS);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Plays random tracks from the start, then seeks to rows of them with music()
+// after another track has left its commands behind, and checks that the sound
+// registers of the following ticks are the same as in the straight playback.
+
+#include "core/core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEEDS 200
+#define SEEKS 8
+#define MAX_TICKS 8192
+#define COMPARE_TICKS 64
+
+typedef struct
+{
+    s32 frame;
+    s32 row;
+    tic_sound_register registers[TIC_SOUND_CHANNELS];
+    tic_stereo_volume stereo;
+} Tick;
+
+static u32 Seed;
+
+static u32 rnd()
+{
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static s32 range(s32 min, s32 max)
+{
+    return min + (s32)(rnd() % (u32)(max - min + 1));
+}
+
+static void fillRandom(void* data, s32 size)
+{
+    for (s32 i = 0; i < size; i++)
+        ((u8*)data)[i] = rnd();
+}
+
+static void initMusic(tic_mem* tic)
+{
+    fillRandom(&tic->ram.sfx, sizeof(tic_sfx));
+    fillRandom(&tic->ram.music.patterns, sizeof(tic_patterns));
+
+    // the seek index never takes jumps, straight playback would
+    for (s32 p = 0; p < MUSIC_PATTERNS; p++)
+        for (s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
+        {
+            tic_track_row* row = &tic->ram.music.patterns.data[p].rows[r];
+
+            if (row->command == tic_music_cmd_jump || row->command >= tic_music_cmd_count)
+                row->command = tic_music_cmd_empty;
+        }
+
+    for (s32 t = 0; t < MUSIC_TRACKS; t++)
+    {
+        tic_track* track = &tic->ram.music.tracks.data[t];
+
+        memset(track, 0, sizeof(tic_track));
+        track->tempo = range(-30, 30);
+        track->rows = range(0, 48);
+        track->speed = range(-4, 4);
+
+        // the first channel always plays, an empty frame ends the track
+        for (s32 f = 0, frames = range(1, MUSIC_FRAMES); f < frames; f++)
+        {
+            u32 patterns = range(PATTERN_START, MUSIC_PATTERNS);
+
+            for (s32 c = 1; c < TIC_SOUND_CHANNELS; c++)
+                patterns |= (range(0, 2) ? range(PATTERN_START, MUSIC_PATTERNS) : 0) << (c * TRACK_PATTERN_BITS);
+
+            for (s32 b = 0; b < TRACK_PATTERNS_SIZE; b++)
+                track->data[f * TRACK_PATTERNS_SIZE + b] = patterns >> (BITS_IN_BYTE * b);
+        }
+    }
+}
+
+static void tick(tic_mem* tic, Tick* data)
+{
+    memset(data, 0, sizeof(Tick));
+    tic_core_sound_tick_start(tic);
+
+    data->frame = tic->ram.sound_state.music.frame;
+    data->row = tic->ram.sound_state.music.row;
+    memcpy(data->registers, tic->ram.registers, sizeof data->registers);
+    data->stereo = tic->ram.stereo;
+
+    tic_core_sound_tick_end(tic);
+}
+
+static bool playing(tic_mem* tic)
+{
+    return tic->ram.sound_state.flag.music_state != tic_music_stop;
+}
+
+// leaves the channels and the commands of another track in the state
+static void playOther(tic_mem* tic, s32 track)
+{
+    tic_api_music(tic, (track + 1) % MUSIC_TRACKS, -1, -1, false, false);
+
+    Tick data;
+    for (s32 i = 0, count = range(1, 400); i < count && playing(tic); i++)
+        tick(tic, &data);
+}
+
+static s32 findRow(const Tick* ticks, s32 count, s32 frame, s32 row)
+{
+    for (s32 i = 0; i < count; i++)
+        if (ticks[i].frame == frame && ticks[i].row == row)
+            return i;
+
+    return -1;
+}
+
+static bool checkSeek(tic_mem* tic, u32 seed, s32 track, const Tick* ticks, s32 count, s32 start)
+{
+    playOther(tic, track);
+    tic_api_music(tic, track, ticks[start].frame, ticks[start].row, false, false);
+
+    for (s32 i = start; i < count && i < start + COMPARE_TICKS; i++)
+    {
+        Tick data;
+        tick(tic, &data);
+
+        if (memcmp(&data, &ticks[i], sizeof(Tick)) != 0)
+        {
+            printf("seed %u, track %d: seek to frame %d row %d differs at tick %d\n",
+                seed, track, ticks[start].frame, ticks[start].row, i - start);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    static Tick Ticks[MAX_TICKS];
+
+    s32 failed = 0, seeks = 0;
+
+    for (u32 seed = 1; seed <= SEEDS; seed++)
+    {
+        tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+
+        Seed = seed;
+        initMusic(tic);
+
+        s32 track = range(0, MUSIC_TRACKS - 1);
+
+        playOther(tic, track);
+        tic_api_music(tic, track, -1, -1, false, false);
+
+        s32 count = 0;
+        while (count < MAX_TICKS && playing(tic))
+            tick(tic, &Ticks[count++]);
+
+        // a seek lands on the first tick of a row
+        s32 starts[SEEKS + 2] = {findRow(Ticks, count, 0, 0), findRow(Ticks, count, 0, 12)};
+        for (s32 i = 2; i < COUNT_OF(starts); i++)
+        {
+            s32 t = range(0, count - 1);
+            starts[i] = findRow(Ticks, count, Ticks[t].frame, Ticks[t].row);
+        }
+
+        for (s32 i = 0; i < COUNT_OF(starts); i++)
+        {
+            if (starts[i] < 0) continue;
+
+            seeks++;
+
+            if (!checkSeek(tic, seed, track, Ticks, count, starts[i]))
+                failed++;
+        }
+
+        tic_core_close(tic);
+    }
+
+    printf("%d of %d seeks differ\n", failed, seeks);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+// MIT License
+
+// Copyright (c) 2017 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Checks the ranges ram() accepts, that drawing recorded before a view is
+// taken lands under the writes made through it, and runs a Lua cart that
+// indexes, writes and measures views in the VM.
+
+#include "core/core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define SCREEN offsetof(tic_ram, vram.screen)
+
+static s32 Failed;
+
+static void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        printf("%s\n", what);
+        Failed++;
+    }
+}
+
+static void checkRanges(tic_mem* tic)
+{
+    static const struct {s32 address; s32 size; bool valid;} Ranges[] =
+    {
+        {0,                         TIC_RAM_SIZE,   true},
+        {0,                         0,              true},
+        {TIC_RAM_SIZE,              0,              true},
+        {TIC_RAM_SIZE - 1,          1,              true},
+        {SCREEN,                    TIC_VRAM_SIZE,  true},
+        {-1,                        1,              false},
+        {0,                         -1,             false},
+        {TIC_RAM_SIZE,              1,              false},
+        {TIC_RAM_SIZE - 1,          2,              false},
+        {1,                         TIC_RAM_SIZE,   false},
+        {0x7fffffff,                1,              false},
+        {1,                         0x7fffffff,     false},
+    };
+
+    for (s32 i = 0; i < COUNT_OF(Ranges); i++)
+    {
+        u8* view = tic_api_ram(tic, Ranges[i].address, Ranges[i].size);
+
+        if (Ranges[i].valid ? view != (u8*)&tic->ram + Ranges[i].address : view != NULL)
+        {
+            printf("ram(%d, %d) ", Ranges[i].address, Ranges[i].size);
+            check(false, Ranges[i].valid ? "isn't a view of the range" : "isn't rejected");
+        }
+    }
+}
+
+// cls() is recorded, the view write and rect() must land on top of it
+static void drawThroughView(tic_mem* tic, bool deferred, u8* screen)
+{
+    memset(tic->ram.vram.screen.data, 0, sizeof tic->ram.vram.screen.data);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    if (deferred)
+    {
+        tic_deferred_direct(tic, false);
+        tic_deferred_begin(tic);
+    }
+#endif
+
+    tic_api_cls(tic, 1);
+
+    u8* view = tic_api_ram(tic, SCREEN, TIC80_WIDTH / 2);
+    view[0] = 0x22;
+    view[1] = 0x33;
+
+    tic_api_rect(tic, 0, 0, 1, 1, 5);
+
+#if defined(TIC_BUILD_WITH_DEFERRED_DRAW)
+    if (deferred)
+        tic_deferred_end(tic);
+#endif
+
+    memcpy(screen, tic->ram.vram.screen.data, TIC80_WIDTH / 2);
+}
+
+static void checkDeferred(tic_mem* tic)
+{
+    u8 expected[TIC80_WIDTH / 2], actual[TIC80_WIDTH / 2];
+
+    drawThroughView(tic, false, expected);
+    drawThroughView(tic, true, actual);
+
+    check(expected[0] == 0x25 && expected[1] == 0x33 && expected[2] == 0x11, "view writes don't land between cls() and rect()");
+    check(memcmp(expected, actual, sizeof expected) == 0, "deferred drawing reorders view writes");
+}
+
+#if defined(TIC_BUILD_WITH_LUA)
+
+static const char LuaCart[] =
+    "-- script: lua\n"
+    "function check(ok,what) if not ok then error(what) end end\n"
+    "function TIC()\n"
+    "  cls(1)\n"
+    "  local s=ram(0,2)\n"
+    "  s[0]=0x22\n"
+    "  rect(0,0,1,1,5)\n"
+    "  local map=0x08000\n"
+    "  local v=ram(map,16)\n"
+    "  check(#v==16,'length')\n"
+    "  check(#ram()==0x18000 and #ram(0x17fff)==1,'default size')\n"
+    "  v[0]=0x12 v[15]=0x134\n"
+    "  check(peek(map)==0x12 and peek(map+15)==0x34,'write')\n"
+    "  poke(map+1,0x77)\n"
+    "  check(v[1]==0x77,'read')\n"
+    "  check(v[16]==nil and v[-1]==nil,'index bounds')\n"
+    "  check(not pcall(function() v[16]=1 end),'newindex above')\n"
+    "  check(not pcall(function() v[-1]=1 end),'newindex below')\n"
+    "  check(not pcall(ram,-1,1) and not pcall(ram,0x17fff,2) and not pcall(ram,0,-1),'ram bounds')\n"
+    "  v:write(2,'\\1\\2')\n"
+    "  check(peek(map+2)==1 and v:read(2,2)=='\\1\\2','read/write')\n"
+    "  check(not pcall(v.write,v,15,'\\1\\2') and not pcall(v.read,v,0,17),'read/write bounds')\n"
+    "  poke(map+100,1)\n"
+    "end\n";
+
+static void onError(void* data, const char* text)
+{
+    printf("lua: %s\n", text);
+    Failed++;
+}
+
+static void onTrace(void* data, const char* text, u8 color) {}
+static void onExit(void* data) {}
+static bool onForceExit(void* data) {return false;}
+static u64 onCounter(void* data) {return 0;}
+static u64 onFreq(void* data) {return 1000;}
+
+static void checkLua(tic_mem* tic)
+{
+    tic_tick_data data = {onTrace, onError, onExit, onForceExit, onCounter, onFreq};
+
+    tic_api_reset(tic);
+    memset(&tic->cart, 0, sizeof(tic_cartridge));
+    strcpy(tic->cart.code.data, LuaCart);
+
+    tic_core_tick_start(tic);
+    tic_core_tick(tic, &data);
+    tic_core_tick_end(tic);
+
+    check(tic->ram.map.data[100] == 1, "the cart didn't finish");
+    check(tic->ram.vram.screen.data[0] == 0x25 && tic->ram.vram.screen.data[1] == 0x11, "view writes don't land between cls() and rect() in Lua");
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+    tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+
+    checkRanges(tic);
+    checkDeferred(tic);
+
+#if defined(TIC_BUILD_WITH_LUA)
+    checkLua(tic);
+#endif
+
+    tic_core_close(tic);
+
+    printf("%d checks failed\n", Failed);
+
+    return Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}